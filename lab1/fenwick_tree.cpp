@@ -4,6 +4,9 @@
 #include <iostream>
 #include <vector>
 #include <sstream>
+#include <algorithm>
+#include <thread>
+#include <atomic>
 
 using namespace std;
 
@@ -18,8 +21,8 @@ auto lsb(int i) -> int {
         1. Increment the value of an index by some value delta
         2. Query the sum of all values in the range 0..i for some index i
     Both these operations run in O(log(n))
-    The tree cannot be instantiated from an existing array, instead you
-    give it a size and get a tree where all indexes begin with a value of 0.
+    The tree can either be given a size, giving a tree where all indexes begin with a value of 0,
+    or be built from an existing array in O(n).
 
     The tree works by associating each index with another index based on the
     least significant 1 in its binary representation.
@@ -43,6 +46,23 @@ struct FenwickTree {
         tree_array = vector<long>(array_len+1, 0);
     }
 
+    /*
+        Build the tree from an existing array in O(n) instead of doing n increments.
+        Going through the indexes in increasing order, once we reach an index its value is final
+        and it only has to be pushed to the next index that covers it (index+lsb(index)),
+        which in turn will push it further when we get there.
+    */
+    FenwickTree(const vector<long> & values) {
+        tree_array = vector<long>(values.size()+1, 0);
+        copy(values.begin(), values.end(), tree_array.begin()+1);
+        for (int index = 1; index < tree_array.size(); ++index) {
+            int parent = index + lsb(index);
+            if (parent < tree_array.size()) {
+                tree_array[parent] += tree_array[index];
+            }
+        }
+    }
+
     // Compute the sum of the first numbers up to, but not including a[index]
     auto prefix_sum_query(int index) -> long {
         if (index == 0) { return 0; }; // index=0 is interpreted as an empty sum
@@ -62,27 +82,363 @@ struct FenwickTree {
             index += lsb(index);
         }
     }
+
+    /*
+        Find the smallest index such that a[0] + ... + a[index] >= prefix, or array_len if there is none.
+        Only works if all values are non-negative (the prefix sums have to be increasing).
+        Instead of binary searching over prefix_sum_query (O(log(n)^2)) we descend the tree from the largest
+        power of two. pos is the number of values known to sum to less than prefix and tree_array[pos+step]
+        is exactly the sum of the next step values, so each step is decided with a single lookup.
+    */
+    auto lower_bound(long prefix) -> int {
+        int pos = 0;
+        long sum = 0;
+        int step = 1;
+        while (2 * step < tree_array.size()) {
+            step *= 2;
+        }
+        for (; step > 0; step /= 2) {
+            if (pos + step < tree_array.size() && sum + tree_array[pos + step] < prefix) {
+                pos += step;
+                sum += tree_array[pos];
+            }
+        }
+        return pos;
+    }
+};
+
+/*
+    Fenwick tree supporting range updates as well as range queries, both in O(log(n)).
+    It uses two trees over the difference array d (a[j] = d[0] + ... + d[j]):
+        added stores d[k] and weighted stores k*d[k]
+    Adding delta to a[l..r) only changes d[l] and d[r], and the sum of the first i values is
+        a[0] + ... + a[i-1] = sum over k < i of d[k]*(i-k) = i*added(i) - weighted(i)
+*/
+struct RangeFenwickTree {
+    FenwickTree added, weighted;
+
+    RangeFenwickTree(int array_len) : added(array_len+1), weighted(array_len+1) {}
+
+    // Build from an existing array in O(n)
+    RangeFenwickTree(const vector<long> & values) : added(0), weighted(0) {
+        vector<long> differences(values.size()+1, 0), weighted_differences(values.size()+1, 0);
+        for (int k = 0; k < values.size(); ++k) {
+            differences[k] = values[k] - (k > 0 ? values[k-1] : 0);
+            weighted_differences[k] = k * differences[k];
+        }
+        added = FenwickTree(differences);
+        weighted = FenwickTree(weighted_differences);
+    }
+
+    // Add delta to a[l], ..., a[r-1]
+    auto range_add(int l, int r, long delta) -> void {
+        added.increment_index(l, delta);
+        added.increment_index(r, -delta);
+        weighted.increment_index(l, delta * l);
+        weighted.increment_index(r, -delta * r);
+    }
+
+    // Compute the sum of the first numbers up to, but not including a[index]
+    auto prefix_sum_query(int index) -> long {
+        return index * added.prefix_sum_query(index) - weighted.prefix_sum_query(index);
+    }
+
+    // Compute a[l] + ... + a[r-1]
+    auto range_sum(int l, int r) -> long {
+        return prefix_sum_query(r) - prefix_sum_query(l);
+    }
+};
+
+/*
+    Cache friendly alternative to FenwickTree with the same operations.
+
+    For large arrays every step of the walk in FenwickTree lands on a different cache line,
+    so a query costs about log2(n) cache misses. Here the values are instead grouped into nodes of
+    B = 8 longs (exactly one 64 byte cache line) and the nodes form a B-ary tree with
+    log_B(n) levels, a third of the levels of the binary tree.
+
+    On level h position j represents the values in [j*B^h, (j+1)*B^h) and stores the sum of
+    all values in its node that come before it (an exclusive prefix sum within the node).
+    The sum of the first i values is then the sum of the entry for position i >> (3h) on every level,
+    which is one cache line per level.
+    Incrementing a value means adding delta to every entry after it in its node on every level.
+    Each node is a vector of B longs (gcc vector extension), so this is done as a single
+    vector add of delta masked with a precomputed mask of the lanes after it.
+
+    Both operations run in O(log_B(n)).
+*/
+struct BlockedFenwickTree {
+    static const int B = 8;
+    static const int LOG_B = 3;
+    typedef long Node __attribute__((vector_size(B * sizeof(long))));
+
+    vector<Node> nodes;
+    vector<int> level_offsets; // Index in nodes of the first node on each level
+    Node after_lane[B]; // after_lane[l][i] has all bits set if i > l
+
+    BlockedFenwickTree(int array_len) {
+        // Position array_len also needs to exist since the sum of all values is queried there
+        long positions = array_len + 1;
+        long nr_of_nodes = 0;
+        do {
+            level_offsets.push_back(nr_of_nodes);
+            positions = (positions + B - 1) / B;
+            nr_of_nodes += positions;
+        } while (positions > 1);
+        nodes = vector<Node>(nr_of_nodes, Node{});
+
+        for (int lane = 0; lane < B; ++lane) {
+            for (int i = 0; i < B; ++i) {
+                after_lane[lane][i] = i > lane ? -1 : 0;
+            }
+        }
+    }
+
+    // Compute the sum of the first numbers up to, but not including a[index]
+    auto prefix_sum_query(int index) -> long {
+        long query_result = 0;
+        unsigned position = index;
+        for (int h = 0; h < level_offsets.size(); ++h, position >>= LOG_B) {
+            query_result += nodes[level_offsets[h] + position / B][position % B];
+        }
+        return query_result;
+    }
+
+    auto increment_index(int index, long delta) -> void {
+        unsigned position = index;
+        for (int h = 0; h < level_offsets.size(); ++h, position >>= LOG_B) {
+            nodes[level_offsets[h] + position / B] += delta & after_lane[position % B];
+        }
+    }
+};
+
+/*
+    Thread safe version of FenwickTree where any number of threads can increment and query at the same time
+    without taking any locks. Every element of tree_array is an atomic which increments update with fetch_add
+    and queries simply read.
+
+    Consistency model:
+    The walk of a query for index i and the walk of an increment for index k share at most one element of
+    tree_array (exactly one if k < i, none otherwise). So a query sees each increment either entirely or
+    not at all, never a partially applied one. A query returns the sum of every increment that completed before
+    the query started plus some subset of the increments running concurrently with it. Once all writers are done
+    every query returns the exact sum. There is however no single point in time at which the whole array
+    had the values a query returns, if two concurrent increments are made to indexes below i it may see
+    either, both or neither.
+*/
+struct ConcurrentFenwickTree {
+
+    vector<atomic<long>> tree_array;
+
+    ConcurrentFenwickTree(int array_len) : tree_array(array_len+1) {
+        for (atomic<long> & value : tree_array) {
+            value.store(0);
+        }
+    }
+
+    // Compute the sum of the first numbers up to, but not including a[index]
+    auto prefix_sum_query(int index) -> long {
+        long query_result = 0;
+        while (index > 0) {
+            query_result += tree_array[index].load();
+            index -= lsb(index);
+        }
+        return query_result;
+    }
+
+    auto increment_index(int index, long delta) -> void {
+        index++; //Array is 1 indexed
+        while (index < tree_array.size()) {
+            tree_array[index].fetch_add(delta);
+            index += lsb(index);
+        }
+    }
+};
+
+// One line of the operation log, "+ index delta" or "? index"
+struct Operation {
+    char op;
+    int index;
+    long delta;
 };
 
+/*
+    Runs of at least this many consecutive queries are split across threads, for shorter runs
+    starting the threads costs more than it saves.
+*/
+const int PARALLEL_QUERY_RUN = 1 << 14;
+
+/*
+    Execute a whole log of operations and return the results of the queries in the order they appear.
+
+    The result is the same as executing the operations one at a time, but a query only reads the tree,
+    so every run of consecutive queries (between two increments) sees the same tree and its queries
+    can be answered in parallel. Each query knows its position in the result beforehand
+    (the number of queries before it), so the threads write their answers directly into place.
+    Operations other than '+' and '?' are ignored.
+*/
+auto execute_operations(FenwickTree & tree, const vector<Operation> & operations) -> vector<long> {
+    int nr_of_queries = count_if(operations.begin(), operations.end(),
+        [](const Operation & operation) { return operation.op == '?'; });
+    vector<long> results(nr_of_queries);
+    int threads = max(1u, thread::hardware_concurrency());
+
+    int result_index = 0;
+    for (int i = 0; i < operations.size();) {
+        if (operations[i].op != '?') {
+            // Anything but an increment or a query is not an operation of the log and is skipped
+            if (operations[i].op == '+') {
+                tree.increment_index(operations[i].index, operations[i].delta);
+            }
+            ++i;
+            continue;
+        }
+        // Find the end of this run of queries
+        int run_start = i;
+        while (i < operations.size() && operations[i].op == '?') {
+            ++i;
+        }
+        int run_len = i - run_start;
+
+        auto answer_queries = [&, run_start, first_result = result_index](int begin, int end) {
+            for (int q = begin; q < end; ++q) {
+                results[first_result + q] = tree.prefix_sum_query(operations[run_start + q].index);
+            }
+        };
+        if (threads == 1 || run_len < PARALLEL_QUERY_RUN) {
+            answer_queries(0, run_len);
+        }
+        else {
+            vector<thread> workers;
+            int chunk = (run_len + threads - 1) / threads;
+            for (int t = 1; t < threads; ++t) {
+                workers.emplace_back(answer_queries, min(t * chunk, run_len), min((t + 1) * chunk, run_len));
+            }
+            answer_queries(0, min(chunk, run_len));
+            for (thread & worker : workers) {
+                worker.join();
+            }
+        }
+        result_index += run_len;
+    }
+    return results;
+}
+
+#ifdef BENCHMARK
+#include <chrono>
+#include <random>
+
+/*
+    Compile with -DBENCHMARK to compare the time per operation of the two trees on random
+    operations (half increments, half queries), for array sizes from a few KB (fits in L1) to 512MB.
+    (-O3 -march=native lets the compiler use the widest vector instructions for the node updates)
+*/
+template<typename Tree>
+auto time_per_operation(int array_len, int nr_of_operations) -> double {
+    Tree tree(array_len);
+    mt19937 rng(0);
+    long checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < nr_of_operations; ++i) {
+        int index = rng() % array_len;
+        if (i % 2 == 0) {
+            tree.increment_index(index, i);
+        }
+        else {
+            checksum += tree.prefix_sum_query(index);
+        }
+    }
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (checksum == 42) { cout << ""; } // Keep the queries from being optimized away
+    return elapsed / nr_of_operations * 1e9;
+}
+
+auto benchmark() -> void {
+    cout << "array_len\tbytes\tFenwickTree (ns/op)\tBlockedFenwickTree (ns/op)\n";
+    for (int array_len = 1 << 10; array_len <= 1 << 26; array_len *= 4) {
+        cout << array_len << "\t" << array_len * sizeof(long)
+            << "\t" << time_per_operation<FenwickTree>(array_len, 4000000)
+            << "\t" << time_per_operation<BlockedFenwickTree>(array_len, 4000000) << "\n";
+    }
+}
+
+/*
+    Contention benchmark for ConcurrentFenwickTree: writers threads increment and readers threads query
+    random indexes of a shared tree for a fixed time, and the total throughput of each kind is reported.
+    Small arrays mean that most writes go to the same few cache lines (high contention).
+*/
+auto concurrent_throughput(int array_len, int writers, int readers) -> pair<double, double> {
+    ConcurrentFenwickTree tree(array_len);
+    atomic<bool> stop(false);
+    atomic<long> increments(0), queries(0), checksum(0);
+
+    auto worker = [&](bool is_writer, int seed) {
+        mt19937 rng(seed);
+        long operations = 0, sum = 0;
+        while (!stop.load(memory_order_relaxed)) {
+            int index = rng() % array_len;
+            if (is_writer) {
+                tree.increment_index(index, 1);
+            }
+            else {
+                sum += tree.prefix_sum_query(index);
+            }
+            ++operations;
+        }
+        (is_writer ? increments : queries) += operations;
+        checksum += sum;
+    };
+
+    vector<thread> threads;
+    for (int t = 0; t < writers + readers; ++t) {
+        threads.emplace_back(worker, t < writers, t);
+    }
+    const double seconds = 0.2;
+    this_thread::sleep_for(chrono::duration<double>(seconds));
+    stop = true;
+    for (thread & t : threads) {
+        t.join();
+    }
+    return {increments / seconds / 1e6, queries / seconds / 1e6};
+}
+
+auto concurrent_benchmark() -> void {
+    int max_threads = max(1u, thread::hardware_concurrency());
+    cout << "\narray_len\twriters\treaders\tincrements (M/s)\tqueries (M/s)\n";
+    for (int array_len : {1 << 10, 1 << 24}) {
+        for (int writers = 1; writers <= max_threads; writers *= 2) {
+            for (int readers = 0; readers <= max_threads; readers = max(1, 2 * readers)) {
+                auto [increments, queries] = concurrent_throughput(array_len, writers, readers);
+                cout << array_len << "\t" << writers << "\t" << readers
+                    << "\t" << increments << "\t" << queries << "\n";
+            }
+        }
+    }
+}
+#endif
+
 auto main() -> int {
+#ifdef BENCHMARK
+    benchmark();
+    concurrent_benchmark();
+    return 0;
+#endif
     int array_len, nr_of_operations;
     cin >> array_len >> nr_of_operations;
 
-    stringstream query_results;
-    FenwickTree fenwick_tree(array_len);
-    for (int i = 0 ; i < nr_of_operations; ++i) {
-        char op;
-        int index;
-        long delta;
-        cin >> op >> index;
-        if (op == '+') {
-            cin >> delta;
-            fenwick_tree.increment_index(index, delta);
-        }
-        if (op == '?') {
-            query_results << fenwick_tree.prefix_sum_query(index) << "\n";
+    vector<Operation> operations(nr_of_operations);
+    for (Operation & operation : operations) {
+        cin >> operation.op >> operation.index;
+        if (operation.op == '+') {
+            cin >> operation.delta;
         }
     }
+
+    FenwickTree fenwick_tree(array_len);
+    stringstream query_results;
+    for (long result : execute_operations(fenwick_tree, operations)) {
+        query_results << result << "\n";
+    }
     cout << query_results.str();
     return 0;
 }
\ No newline at end of file
@@ -3,6 +3,21 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <charconv>
+#include <cctype>
+#include <cstdio>
+#include <deque>
+#include <queue>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #define NOT_FOUND -1
 
@@ -10,90 +25,392 @@ using namespace std;
 
 /*
     Algorithm:
-    1. let n = a (beginning of interval), 
+    1. let n = a (beginning of interval),
         S = {} (set containing indexes of intervals for solution)
 
     2. Let M be the set of all intervals [a_i, b_i] where a_i <= n
-    3. If M is empty then output "impossible" and stop 
+    3. If M is empty then output "impossible" and stop
     4. Find [a_j, b_j] in M that maximizes (b_j - n)
     4. Add the index of [a_j, b_j] to S and set n to b_j
     5. Remove [a_j, b_j] from future intervals
     6. If n != b (end of interval) then goto 2
     7. Output cardinality of S and S itself on two lines
+
+    Since n only grows, so does M, so instead of scanning all intervals for every step we sort the
+    intervals by a_i once and sweep over them, adding the ones with a_i <= n to M and keeping track of
+    the best one so far (the largest b_j, the lowest index on ties). If the best one doesn't reach past n
+    there is no way to get further. That's O(n log n) for the sort and O(n) for the sweep.
+    Returns the indices of the intervals of the cover, which is empty if it's impossible.
 */
-auto solve (double a, double b, vector<pair<double, double>> intervals) {
-    vector<bool> used_intervals(intervals.size(), false); // Keep track of what intervals are already in the solution
+auto solve (double a, double b, const vector<pair<double, double>> & intervals) -> vector<int> {
+    vector<int> order(intervals.size());
+    for (int i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&](int i, int j) {
+        return intervals[i].first < intervals[j].first;
+    });
+
+    // if a == b choose the first interval that includes a
+    if (a == b) {
+        int first = NOT_FOUND;
+        for (int i = 0; i < order.size() && intervals[order[i]].first <= a; ++i) {
+            if (intervals[order[i]].second >= a && (first == NOT_FOUND || order[i] < first)) {
+                first = order[i];
+            }
+        }
+        return first == NOT_FOUND ? vector<int>() : vector<int>{first};
+    }
 
     double n = a;
     vector<int> solution; // S Here
-    while (true) {
-        // if a == b choose the first interval that includes a
-        if (a == b) {
-            for (int i = 0; i < intervals.size(); ++i) {
-                if (intervals[i].first <= a 
-                    &&  intervals[i].second >= a) {
-                        cout << 1 << "\n" << i << "\n";
-                        return;
-                }
+    int max_index = NOT_FOUND;
+    for (int next = 0; n < b;) {
+        for (; next < order.size() && intervals[order[next]].first <= n; ++next) {
+            int i = order[next];
+            if (max_index == NOT_FOUND || intervals[i].second > intervals[max_index].second
+                || (intervals[i].second == intervals[max_index].second && i < max_index)) {
+                max_index = i;
             }
         }
+        if (max_index == NOT_FOUND || intervals[max_index].second <= n) { // Nothing in M gets us further
+            return vector<int>();
+        }
+        solution.push_back(max_index); // Update solution and n
+        n = intervals[max_index].second;
+    }
+    return solution;
+}
 
-        int max_index = NOT_FOUND;
-        double max_distance = -1;
-        double new_n = 0;
-        for (int i = 0; i < intervals.size(); ++i) { // We don't need to actually construct M to find the max
-            if (used_intervals[i]) { continue; }
+/*
+    For answering many covers [a, b] with the same intervals. The greedy choice from a point n is always the
+    interval with the largest b_j among the ones with a_j <= n, which after sorting by a_j is a prefix maximum
+    found by binary search. From a chosen interval j the next one is the greedy choice from b_j, so the
+    choices form a tree and we store the 2^k:th next interval of every interval (binary lifting).
+    A cover then jumps as far as possible while staying below b, in O(log n) jumps.
+*/
+struct IntervalIndex {
+    vector<pair<double, double>> intervals;
+    vector<double> starts;       // The a_i in increasing order
+    vector<int> prefix_best;     // The interval with the largest b_j of the first i+1 in order of a_j
+    vector<vector<int>> jumps;   // jumps[k][j] is the interval chosen 2^k steps after interval j
 
-            double a_j = intervals[i].first;
-            double b_j = intervals[i].second;
-            if (a_j <= n) {
-                double distance = b_j - n;
+    IntervalIndex(const vector<pair<double, double>> & intervals) : intervals(intervals) {
+        int n = intervals.size();
+        vector<int> order(n);
+        for (int i = 0; i < n; ++i) {
+            order[i] = i;
+        }
+        sort(order.begin(), order.end(), [&](int i, int j) {
+            return intervals[i].first < intervals[j].first;
+        });
+        starts.resize(n);
+        prefix_best.resize(n);
+        for (int k = 0; k < n; ++k) {
+            int i = order[k];
+            starts[k] = intervals[i].first;
+            int best = k > 0 ? prefix_best[k-1] : i;
+            if (intervals[i].second > intervals[best].second
+                || (intervals[i].second == intervals[best].second && i < best)) {
+                best = i;
+            }
+            prefix_best[k] = best;
+        }
 
-                if (distance > max_distance) {
-                    max_distance = distance;
-                    max_index = i;
-                    new_n = b_j;
-                }
+        jumps.push_back(vector<int>(n));
+        for (int j = 0; j < n; ++j) {
+            jumps[0][j] = greedy_choice(intervals[j].second);
+        }
+        for (int k = 1; (1 << k) < max(n, 2); ++k) {
+            jumps.push_back(vector<int>(n));
+            for (int j = 0; j < n; ++j) {
+                jumps[k][j] = jumps[k-1][jumps[k-1][j]];
+            }
+        }
+    }
+
+    // The interval with the largest end among the ones starting at or before n
+    auto greedy_choice(double n) const -> int {
+        int k = upper_bound(starts.begin(), starts.end(), n) - starts.begin();
+        return k == 0 ? NOT_FOUND : prefix_best[k-1];
+    }
+
+    // The first interval of the cover of [a, b], or NOT_FOUND if there is none
+    auto first(double a, double b) const -> int {
+        int j = greedy_choice(a);
+        if (j == NOT_FOUND || intervals[j].second < a || (a < b && intervals[j].second <= a)) {
+            return NOT_FOUND;
+        }
+        return j;
+    }
+
+    // The number of intervals needed to cover [a, b], or NOT_FOUND if it's impossible, in O(log n)
+    auto cover_size(double a, double b) const -> int {
+        int j = first(a, b);
+        if (j == NOT_FOUND || intervals[j].second >= b) {
+            return j == NOT_FOUND ? NOT_FOUND : 1;
+        }
+        int size = 1;
+        for (int k = jumps.size() - 1; k >= 0; --k) {
+            if (intervals[jumps[k][j]].second < b) {
+                j = jumps[k][j];
+                size += 1 << k;
             }
         }
-        if (max_index == NOT_FOUND) { // Check if M is empty
-            cout << "impossible\n";
-            return;
+        // One more jump takes us to b unless we are stuck
+        if (intervals[jumps[0][j]].second < b) {
+            return NOT_FOUND;
         }
-        used_intervals[max_index] = true; // Mark interval as used
+        return size + 1;
+    }
 
-        solution.push_back(max_index); // Update solution and n
-        n = new_n;
-        if (n >= b) {
-            break;
+    // The intervals of the cover of [a, b], which is empty if it's impossible
+    auto cover(double a, double b) const -> vector<int> {
+        int size = cover_size(a, b);
+        vector<int> solution;
+        for (int i = 0, j = first(a, b); i < size; ++i, j = jumps[0][j]) {
+            solution.push_back(j);
         }
+        return solution;
+    }
+};
+
+auto print_cover(const vector<int> & solution, ostream & output) -> void {
+    if (solution.empty()) {
+        output << "impossible\n";
+        return;
     }
-    // Print result
-    cout << solution.size() << "\n";
+    output << solution.size() << "\n";
     for (int i = 0; i < solution.size(); ++i) {
-        cout << solution[i];
+        output << solution[i];
         if (i < solution.size() - 1) {
-            cout << " ";
+            output << " ";
         }
     }
-    cout << "\n";
+    output << "\n";
 }
 
-// Main just reads the main numeric intervals + cover intervals
-auto main () -> int {
-    double a, b; 
-    while (cin >> a >> b) {
-        int nr_of_intervals;
-        cin >> nr_of_intervals;
-        vector<pair<double, double>> intervals(nr_of_intervals);
-        cin.clear();
-        for (int i = 0; i < nr_of_intervals; ++i) {
-            double a_i, b_i;
-            cin >> a_i; cin.clear();
-            cin >> b_i;
-            intervals[i] = make_pair(a_i, b_i);
-        }
-        solve(a, b, intervals);
+/*
+    The whole input as one block of memory. A regular file is mapped (so the pages are read as the parser
+    gets to them instead of being copied through a stream), anything else like a pipe is read into a buffer.
+*/
+struct Input {
+    const char * begin = nullptr, * end = nullptr;
+    void * mapping = nullptr;
+    size_t bytes = 0;
+    vector<char> buffer;
+
+    Input(int fd) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            bytes = info.st_size;
+            mapping = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                madvise(mapping, bytes, MADV_SEQUENTIAL);
+                begin = static_cast<const char *>(mapping);
+                end = begin + bytes;
+                return;
+            }
+            mapping = nullptr;
+        }
+        char chunk[1 << 16];
+        ssize_t read_bytes;
+        while ((read_bytes = read(fd, chunk, sizeof(chunk))) > 0) {
+            buffer.insert(buffer.end(), chunk, chunk + read_bytes);
+        }
+        begin = buffer.data();
+        end = begin + buffer.size();
+    }
+
+    Input(const Input &) = delete;
+    auto operator=(const Input &) -> Input & = delete;
+
+    ~Input() {
+        if (mapping != nullptr) {
+            munmap(mapping, bytes);
+        }
     }
+};
+
+/*
+    Reads the numbers separated by whitespace with from_chars, which parses straight from the memory
+    without locales or stream state (and rounds doubles exactly like cin does).
+*/
+struct Parser {
+    const char * position, * end;
+
+    template<typename T>
+    auto next(T & value) -> bool {
+        while (position < end && (isspace((unsigned char)*position) || *position == '+')) {
+            ++position;
+        }
+        auto [number_end, error] = from_chars(position, end, value);
+        if (error != errc()) {
+            return false;
+        }
+        position = number_end;
+        return true;
+    }
+};
+
+struct Case {
+    double a, b;
+    vector<pair<double, double>> intervals;
+    long nr_of_intervals;
+    string output;
+    bool done = false;
+};
+
+/*
+    Solves all the cases of the input on threads workers while the main thread keeps parsing:
+    Every parsed case is put in a queue for the workers, who write the output of a case to the case itself.
+    The main thread writes the outputs of the cases that are done in the order of the input to one buffer,
+    which goes to the file in big blocks. If more than MAX_PENDING_INTERVALS intervals are parsed but not
+    written yet the main thread waits for the first case to be done, so the memory use stays bounded.
+*/
+const long MAX_PENDING_INTERVALS = 1 << 24;
+const size_t OUTPUT_BLOCK = 1 << 20;
+
+auto solve_all(Parser & parser, FILE * file, int threads) -> void {
+    deque<unique_ptr<Case>> pending;
+    queue<Case *> jobs;
+    bool parsed_all = false;
+    mutex lock;
+    condition_variable job_ready, case_done;
+
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            while (true) {
+                Case * job;
+                {
+                    unique_lock<mutex> guard(lock);
+                    job_ready.wait(guard, [&]() { return !jobs.empty() || parsed_all; });
+                    if (jobs.empty()) {
+                        return;
+                    }
+                    job = jobs.front();
+                    jobs.pop();
+                }
+                ostringstream output;
+                print_cover(solve(job->a, job->b, job->intervals), output);
+                job->intervals = vector<pair<double, double>>();
+                {
+                    lock_guard<mutex> guard(lock);
+                    job->output = output.str();
+                    job->done = true;
+                }
+                case_done.notify_one();
+            }
+        });
+    }
+
+    string output;
+    long pending_intervals = 0;
+    // Moves the outputs of the first cases which are done to output, waiting until at most limit intervals are pending
+    auto collect = [&](long limit) {
+        unique_lock<mutex> guard(lock);
+        while (!pending.empty()) {
+            if (!pending.front()->done) {
+                if (pending_intervals <= limit) {
+                    break;
+                }
+                case_done.wait(guard, [&]() { return pending.front()->done; });
+            }
+            output += pending.front()->output;
+            pending_intervals -= pending.front()->nr_of_intervals;
+            pending.pop_front();
+        }
+        guard.unlock();
+        if (output.size() >= OUTPUT_BLOCK) {
+            fwrite(output.data(), 1, output.size(), file);
+            output.clear();
+        }
+    };
+
+    double a, b;
+    while (parser.next(a) && parser.next(b)) {
+        int nr_of_intervals = 0;
+        parser.next(nr_of_intervals);
+        auto job = make_unique<Case>();
+        job->a = a;
+        job->b = b;
+        job->nr_of_intervals = nr_of_intervals;
+        job->intervals.resize(nr_of_intervals);
+        for (auto & [a_i, b_i] : job->intervals) {
+            parser.next(a_i);
+            parser.next(b_i);
+        }
+        {
+            lock_guard<mutex> guard(lock);
+            pending_intervals += nr_of_intervals;
+            jobs.push(job.get());
+            pending.push_back(move(job));
+        }
+        job_ready.notify_one();
+        collect(MAX_PENDING_INTERVALS);
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        parsed_all = true;
+    }
+    job_ready.notify_all();
+    collect(-1);
+    for (thread & worker : workers) {
+        worker.join();
+    }
+    fwrite(output.data(), 1, output.size(), file);
+    fflush(file);
+}
+
+#ifdef BENCHMARK
+#include <chrono>
+#include <random>
+
+/*
+    Compile with -DBENCHMARK to time one cover of 10^6 random intervals with solve, and 10^6 random
+    covers [a, b] of the same intervals with an IntervalIndex, and the time to build it.
+*/
+auto benchmark() -> void {
+    const int n = 1000000, queries = 1000000;
+    mt19937 rng(0);
+    uniform_real_distribution<double> position(0, 1e6), length(0, 50);
+    vector<pair<double, double>> intervals(n);
+    for (auto & [a_i, b_i] : intervals) {
+        a_i = position(rng);
+        b_i = a_i + length(rng);
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<int> solution = solve(1000, 900000, intervals);
+    double solve_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    IntervalIndex index(intervals);
+    double build_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long total = 0;
+    start = chrono::steady_clock::now();
+    for (int q = 0; q < queries; ++q) {
+        double a = position(rng), b = a + position(rng) / 10;
+        total += index.cover_size(a, b);
+    }
+    double query_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "solve: " << solve_time << " s (cover of " << solution.size() << " intervals, "
+        << index.cover_size(1000, 900000) << " by the index)\n";
+    cout << "index: " << build_time << " s to build, " << query_time / queries * 1e9 << " ns per cover"
+        << " (checksum " << total << ")\n";
+}
+#endif
+
+// Main just reads the main numeric intervals + cover intervals, see solve_all
+auto main () -> int {
+#ifdef BENCHMARK
+    benchmark();
+    return 0;
+#endif
+    Input input(STDIN_FILENO);
+    Parser parser{input.begin, input.end};
+    solve_all(parser, stdout, max(1u, thread::hardware_concurrency()));
     return 0;
 }
\ No newline at end of file
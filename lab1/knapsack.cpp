@@ -4,58 +4,536 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <atomic>
 
 using namespace std;
 
+/*
+    Above this many decisions (bits) solve_knapsack doesn't store the decision of every object for every capacity
+    but splits the objects in half first (see solve_divide_and_conquer).
+*/
+const long DECISION_BITS_LIMIT = 1L << 33; // 1GB
+
+/*
+    The cells [lo, hi) of one row of the dynamic programming table, next[c_i] is the best value with
+    capacity c_i given that prev holds the best values without the object.
+    The loop is written with explicit 8 lane vectors (gcc vector extensions) since the compiler won't
+    vectorize it by itself at -O2. The two rows never overlap so lanes are independent.
+*/
+typedef int Lanes __attribute__((vector_size(8 * sizeof(int))));
+
+void knapsack_step(const int * __restrict prev, int * __restrict next, int lo, int hi, int value, int weight) {
+    int first = min(max(weight, lo), hi);
+    for (int c_i = lo; c_i < first; ++c_i) {
+        next[c_i] = prev[c_i];
+    }
+    int c_i = first;
+    Lanes values = value - Lanes{};
+    for (; c_i + 8 <= hi; c_i += 8) {
+        Lanes excluded, included;
+        memcpy(&excluded, prev + c_i, sizeof(Lanes));
+        memcpy(&included, prev + c_i - weight, sizeof(Lanes));
+        included += values;
+        Lanes best = included > excluded ? included : excluded;
+        memcpy(next + c_i, &best, sizeof(Lanes));
+    }
+    for (; c_i < hi; ++c_i) {
+        next[c_i] = max(prev[c_i], prev[c_i-weight] + value);
+    }
+}
+
+/*
+    Words [word_begin, word_end) of the decision bits of a row, bit c_i is set if the object was
+    included for capacity c_i, which is exactly when the value differs from the row above.
+*/
+void record_decisions(const int * prev, const int * next, uint64_t * row, int word_begin, int word_end, int c) {
+    for (int word = word_begin; word < word_end; ++word) {
+        int base = word * 64, bits = min(64, c+1 - base);
+        uint8_t changed[64] = {};
+        for (int bit = 0; bit < bits; ++bit) {
+            changed[bit] = next[base + bit] != prev[base + bit];
+        }
+        /*
+            Pack 8 bytes which are 0 or 1 into the 8 bits of one byte at a time. Multiplying by
+            this constant puts byte k of eight in bit 56+k, and no two products overlap.
+        */
+        uint64_t decisions = 0;
+        for (int byte = 0; byte < 8; ++byte) {
+            uint64_t eight;
+            memcpy(&eight, changed + 8 * byte, 8);
+            decisions |= ((eight * 0x0102040810204080ULL) >> 56) << (8 * byte);
+        }
+        row[word] = decisions;
+    }
+}
+
+// Starts the row workers of knapsack_rows, f(t) fills slice t of every row, f(0) on the calling thread
+template<typename F>
+auto run_on_threads(int threads, F f) -> void {
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(f, t);
+    }
+    f(0);
+    for (thread & worker : workers) {
+        worker.join();
+    }
+}
+
+/*
+    The wait between two rows of knapsack_rows, where every thread needs the whole row above before it
+    starts on its slice of the next one. A slice of a row takes microseconds, no more than putting a
+    thread to sleep and waking it again, so the threads spin, yielding in case there are more of them
+    than cores. The last thread to arrive bumps the generation, whose release store publishes the row.
+*/
+struct SpinBarrier {
+    int threads;
+    atomic<int> arrived{0};
+    atomic<int> generation{0};
+
+    SpinBarrier(int threads) : threads(threads) {}
+
+    auto wait() -> void {
+        int current = generation.load(memory_order_acquire);
+        if (arrived.fetch_add(1, memory_order_acq_rel) == threads - 1) {
+            arrived.store(0, memory_order_relaxed);
+            generation.store(current + 1, memory_order_release);
+            return;
+        }
+        while (generation.load(memory_order_acquire) == current) {
+            this_thread::yield();
+        }
+    }
+};
+
+/*
+    Rows with at least PARALLEL_MIN_SLICE capacities per thread are split across up to knapsack_threads
+    threads. Every thread owns the same slice of every row, a whole number of 64 capacities so that it
+    owns whole words of the decision bits too. A row only reads the row above, so the threads only
+    wait for each other between rows. Every cell is computed by the same code whatever slice it is in,
+    so the result is bit-identical for any number of threads.
+*/
+const int PARALLEL_MIN_SLICE = 1 << 14;
+int knapsack_threads = max(1u, thread::hardware_concurrency());
+
+/*
+    Runs the dynamic programming for objects[begin, end) alternating between the rows even and odd
+    (both of size c+1) and returns the last row. If decisions isn't null, the decision bits for
+    object n_i are written to the words decisions[(n_i-begin) * words, (n_i-begin+1) * words).
+*/
+auto knapsack_rows(const vector<pair<int, int>> & objects, int begin, int end, int c,
+    vector<int> & even, vector<int> & odd, uint64_t * decisions) -> vector<int> & {
+
+    int words = (c+1 + 63) / 64;
+    int threads = max(1, min(knapsack_threads, (c+1) / PARALLEL_MIN_SLICE));
+    int words_per_thread = (words + threads - 1) / threads;
+    fill(even.begin(), even.end(), 0);
+    SpinBarrier barrier(threads);
+
+    run_on_threads(threads, [&](int t) {
+        int word_begin = min(t * words_per_thread, words), word_end = min(word_begin + words_per_thread, words);
+        int lo = word_begin * 64, hi = min(word_end * 64, c+1);
+        for (int n_i = begin; n_i < end; ++n_i) {
+            const vector<int> & prev = (n_i - begin) % 2 == 0 ? even : odd;
+            vector<int> & next = (n_i - begin) % 2 == 0 ? odd : even;
+            auto [value, weight] = objects[n_i];
+            knapsack_step(prev.data(), next.data(), lo, hi, value, weight);
+            if (decisions != nullptr) {
+                record_decisions(prev.data(), next.data(), decisions + long(n_i - begin) * words, word_begin, word_end, c);
+            }
+            if (threads > 1) {
+                barrier.wait();
+            }
+        }
+    });
+    return (end - begin) % 2 == 0 ? even : odd;
+}
+
+// The last row of the table for objects[begin, end) using only two rows of memory
+auto knapsack_row(const vector<pair<int, int>> & objects, int begin, int end, int c) -> vector<int> {
+    vector<int> even(c+1), odd(c+1);
+    return move(knapsack_rows(objects, begin, end, c, even, odd, nullptr));
+}
+
 /* 
-    Solving 0/1 knapsack using dynamic programming using bottom up approach 
+    Solving 0/1 knapsack using dynamic programming using bottom up approach for objects[begin, end)
+    The indices of the chosen objects are appended to indicies in increasing order.
+
+    Instead of the whole n*c table of values we only keep two rows, and for reconstructing the solution
+    a single bit per cell, whether the object was included (see record_decisions). That takes 32 times
+    less memory than the table and the rows stay in cache.
 */
-auto solve_knapsack(int n, int c, 
-    vector<pair<int, int>> &objects) -> vector<int> {
+auto solve_with_decisions(const vector<pair<int, int>> & objects, int begin, int end, int c,
+    vector<int> & indicies) -> void {
+
+    int words = (c+1 + 63) / 64;
+    vector<uint64_t> included(long(end - begin) * words);
+    vector<int> even(c+1), odd(c+1);
+    knapsack_rows(objects, begin, end, c, even, odd, included.data());
 
     /* 
-        Compute a n*c sized table containing the solutions for all the
-        subproblems (and the main problem) in O(n*c)
+        Backtrack using the decisions to determine the objects selected.
     */
-    vector<vector<int>> knapsack_values(n+1, vector<int>(c+1, 0));
-    for (int n_i = 1; n_i < n+1; ++n_i) {
-        auto [value, weight] = objects[n_i-1];
+    int c_i = c;
+    int first_index = indicies.size();
+    for (int n_i = end-1; n_i >= begin; --n_i) {
+        const uint64_t * row = &included[long(n_i - begin) * words];
+        if (row[c_i / 64] >> (c_i % 64) & 1) {
+            indicies.push_back(n_i);
+            c_i -= objects[n_i].second;
+        }
+    }
+    reverse(indicies.begin() + first_index, indicies.end());
+}
 
-        for (int c_i = 1; c_i < c+1; ++c_i) {
+/*
+    When even the decision bits don't fit we use divide and conquer (like Hirschberg's algorithm):
+    Compute the last row f for the first half of the objects and g for the second half. An optimal
+    solution uses some capacity k on the first half and c-k on the second, and k is the one
+    maximizing f[k] + g[c-k]. Then solve the two halves with capacities k and c-k independently.
+    Only O(c) memory is used for the rows, and since the capacities of the subproblems on each level
+    add up to c every level takes half the time of the one above, so about twice the time of the plain dp in total.
+*/
+auto solve_divide_and_conquer(const vector<pair<int, int>> & objects, int begin, int end, int c,
+    vector<int> & indicies) -> void {
 
-            int new_value = knapsack_values[n_i-1][c_i-weight] + value;
-            // Include the object if it leads to a greater value
-            if (c_i >= weight && new_value > knapsack_values[n_i-1][c_i]) {
-                knapsack_values[n_i][c_i] = new_value;
-            }
-            // Otherwise we exclude it
-            else {
-                knapsack_values[n_i][c_i] = knapsack_values[n_i-1][c_i];
+    if (long(end - begin) * (c+1) <= DECISION_BITS_LIMIT || end - begin == 1) {
+        solve_with_decisions(objects, begin, end, c, indicies);
+        return;
+    }
+    int mid = (begin + end) / 2;
+    int best_k = 0;
+    {
+        vector<int> f = knapsack_row(objects, begin, mid, c);
+        vector<int> g = knapsack_row(objects, mid, end, c);
+        for (int k = 0; k < c+1; ++k) {
+            if (f[k] + g[c-k] > f[best_k] + g[c-best_k]) {
+                best_k = k;
             }
         }
     }
+    solve_divide_and_conquer(objects, begin, mid, best_k, indicies);
+    solve_divide_and_conquer(objects, mid, end, c - best_k, indicies);
+}
 
-    /* 
-        Backtrack using the previously computed table to determine the object selected.
+/*
+    Branch and bound for when the capacity is too large for the table (but there are few objects).
+    The objects are sorted by value per weight and searched depth first, taking the object before
+    leaving it. A branch is cut when even the bound of the LP relaxation, filling the remaining capacity
+    greedily and taking a fraction of the first object that doesn't fit, is no better than the best
+    solution found so far. With prefix sums over the sorted objects the bound takes O(log n).
+*/
+struct BranchAndBound {
+    vector<int> order;
+    vector<long> prefix_value, prefix_weight;
+    const vector<pair<int, int>> & objects;
+    vector<bool> taken, best_taken;
+    long best = -1;
+    long free_value = 0;
+
+    /*
+        Objects without weight are always worth taking (if worth anything) and are taken right away.
+        They are left out of the search, which also keeps the ratio comparison a strict weak ordering:
+        an object with neither value nor weight would compare equivalent to every other object.
     */
-    int c_i = c;
+    BranchAndBound(const vector<pair<int, int>> & objects) : objects(objects) {
+        taken.assign(objects.size(), false);
+        for (int i = 0; i < (int)objects.size(); ++i) {
+            if (objects[i].second != 0) {
+                order.push_back(i);
+            }
+            else if (objects[i].first > 0) {
+                taken[i] = true;
+                free_value += objects[i].first;
+            }
+        }
+        int n = order.size();
+        sort(order.begin(), order.end(), [&](int a, int b) {
+            return long(objects[a].first) * objects[b].second > long(objects[b].first) * objects[a].second;
+        });
+        prefix_value.assign(n+1, 0);
+        prefix_weight.assign(n+1, 0);
+        for (int i = 0; i < n; ++i) {
+            prefix_value[i+1] = prefix_value[i] + objects[order[i]].first;
+            prefix_weight[i+1] = prefix_weight[i] + objects[order[i]].second;
+        }
+    }
+
+    // Upper bound of the value of any solution deciding the objects from i with room capacity left
+    auto bound(int i, long room) -> long {
+        int n = order.size();
+        // The last k such that order[i, k) fits entirely
+        int k = upper_bound(prefix_weight.begin() + i, prefix_weight.end(), prefix_weight[i] + room) - prefix_weight.begin() - 1;
+        long value = prefix_value[k] - prefix_value[i];
+        if (k < n) {
+            auto [next_value, next_weight] = objects[order[k]];
+            value += (room - (prefix_weight[k] - prefix_weight[i])) * next_value / next_weight;
+        }
+        return value;
+    }
+
+    auto search(int i, long room, long value) -> void {
+        if (value > best) {
+            best = value;
+            best_taken = taken;
+        }
+        if (i == (int)order.size() || value + bound(i, room) <= best) {
+            return;
+        }
+        auto [object_value, object_weight] = objects[order[i]];
+        if (object_weight <= room) {
+            taken[order[i]] = true;
+            search(i+1, room - object_weight, value + object_value);
+            taken[order[i]] = false;
+        }
+        search(i+1, room, value);
+    }
+};
+
+// The indices of an optimal choice of objects, in increasing order
+auto branch_and_bound(const vector<pair<int, int>> & objects, long c) -> vector<int> {
+    BranchAndBound solver(objects);
+    solver.search(0, c, solver.free_value);
     vector<int> indicies;
-    for (int n_i = n; n_i > 0; --n_i) {
-        /*
-            If the current value is not the same as the one for the previous object then
-            that means we must have not excluded it when computing the table
-        */         
-       if (knapsack_values[n_i][c_i] != knapsack_values[n_i-1][c_i]) {
-            indicies.push_back(n_i-1);
-            c_i -= objects[n_i-1].second;
+    for (int i = 0; i < (int)objects.size(); ++i) {
+        if (solver.best_taken[i]) {
+            indicies.push_back(i);
         }
     }
-    
-    reverse(indicies.begin(), indicies.end());
     return indicies;
 }
 
+/*
+    Above this capacity the two rows of the table alone would take more than 512MB, so solve_bounded_knapsack
+    uses branch and bound instead.
+*/
+const int TABLE_CAPACITY_LIMIT = 1 << 26;
+
+struct BoundedObject {
+    int value, weight;
+    long count;
+};
+
+/*
+    How many copies of every object might be part of an optimal solution, using dominance:
+    Object i dominates object j if it weighs at most as much and is worth at least as much (ties broken
+    by the order sorted by weight and then decreasing value, and copies by their order). Among the optimal
+    solutions there is one where every chosen object has all the objects that dominate it chosen too,
+    as otherwise swapping them would give a solution which is at least as good. So a copy can only be used
+    if its weight plus the weight of everything dominating it fits in c.
+    The weight of the dominating objects (the earlier ones in the sorted order worth at least as much)
+    is summed by a fenwick tree over the ranks of the values, capped at c+1.
+*/
+auto usable_counts(const vector<BoundedObject> & objects, int c) -> vector<long> {
+    int n = objects.size();
+    vector<int> order(n);
+    for (int i = 0; i < n; ++i) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&](int a, int b) {
+        if (objects[a].weight != objects[b].weight) {
+            return objects[a].weight < objects[b].weight;
+        }
+        return objects[a].value > objects[b].value;
+    });
+    // The values in decreasing order, the fenwick tree is indexed by position in it
+    vector<int> values(n);
+    for (int i = 0; i < n; ++i) {
+        values[i] = objects[i].value;
+    }
+    sort(values.begin(), values.end(), greater<int>());
+    vector<long> dominating_weight(n+1, 0);
+
+    vector<long> usable(n, 0);
+    for (int i : order) {
+        auto [value, weight, count] = objects[i];
+        int rank = upper_bound(values.begin(), values.end(), value, greater<int>()) - values.begin();
+        long dominating = 0;
+        for (int r = rank; r > 0; r -= r & -r) {
+            dominating = min<long>(dominating + dominating_weight[r], c+1);
+        }
+        if (value > 0 && dominating <= c) {
+            usable[i] = weight == 0 ? count : min(count, (c - dominating) / weight);
+        }
+        long total_weight = weight != 0 && count > c / weight ? c+1 : weight * count;
+        rank = lower_bound(values.begin(), values.end(), value, greater<int>()) - values.begin() + 1;
+        for (int r = rank; r <= n; r += r & -r) {
+            dominating_weight[r] = min<long>(dominating_weight[r] + total_weight, c+1);
+        }
+    }
+    return usable;
+}
+
+/*
+    Bounded knapsack, every object can be chosen up to count times. Returns how many copies of every
+    object to choose.
+    Dominated copies are dropped first (see usable_counts). The usable copies of an object are then split
+    into 0/1 pieces of 1, 2, 4, ... copies and the rest, so any number of copies up to the count is the sum of
+    some pieces. That turns the k copies of an object into O(log k) rows of the table instead of k.
+*/
+auto solve_bounded_knapsack(int c, const vector<BoundedObject> & objects) -> vector<long> {
+    vector<long> usable = usable_counts(objects, c);
+    vector<pair<int, int>> pieces;
+    vector<pair<int, long>> piece_copies; // The object of every piece and its number of copies
+    for (int i = 0; i < (int)objects.size(); ++i) {
+        for (long copies = 1, left = usable[i]; left > 0; copies *= 2) {
+            long piece = min(copies, left);
+            pieces.push_back(make_pair(objects[i].value * piece, objects[i].weight * piece));
+            piece_copies.push_back(make_pair(i, piece));
+            left -= piece;
+        }
+    }
+
+    vector<int> chosen;
+    if (c >= TABLE_CAPACITY_LIMIT) {
+        chosen = branch_and_bound(pieces, c);
+    }
+    else if (!pieces.empty()) {
+        solve_divide_and_conquer(pieces, 0, pieces.size(), c, chosen);
+    }
+    vector<long> taken(objects.size(), 0);
+    for (int piece : chosen) {
+        taken[piece_copies[piece].first] += piece_copies[piece].second;
+    }
+    return taken;
+}
+
+/*
+    Unbounded knapsack, every object can be chosen any number of times. An object without weight but with
+    a value makes the best value unbounded, such objects are reported as chosen once.
+*/
+auto solve_unbounded_knapsack(int c, const vector<pair<int, int>> & objects) -> vector<long> {
+    vector<BoundedObject> bounded;
+    for (auto [value, weight] : objects) {
+        long count = weight == 0 ? (value > 0 ? 1 : 0) : c / weight;
+        bounded.push_back(BoundedObject{value, weight, count});
+    }
+    return solve_bounded_knapsack(c, bounded);
+}
+
+/*
+    0/1 knapsack, identical objects are grouped into one bounded object so that they get few pieces,
+    and the chosen copies are given the first indices of the group.
+*/
+auto solve_knapsack(int n, int c, 
+    vector<pair<int, int>> &objects) -> vector<int> {
+
+    vector<int> order(n);
+    for (int i = 0; i < n; ++i) {
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return objects[a] < objects[b];
+    });
+    vector<BoundedObject> groups;
+    vector<int> group_begin;
+    for (int i = 0; i < n; ++i) {
+        if (i == 0 || objects[order[i]] != objects[order[i-1]]) {
+            groups.push_back(BoundedObject{objects[order[i]].first, objects[order[i]].second, 0});
+            group_begin.push_back(i);
+        }
+        groups.back().count++;
+    }
+
+    vector<long> taken = solve_bounded_knapsack(c, groups);
+    vector<int> indicies;
+    for (int g = 0; g < (int)groups.size(); ++g) {
+        for (int i = group_begin[g]; i < group_begin[g] + taken[g]; ++i) {
+            indicies.push_back(order[i]);
+        }
+    }
+    sort(indicies.begin(), indicies.end());
+    return indicies;
+}
+
+/*
+    Subset sum (which sums <= c can be made from a subset of the weights) using a bitset where
+    bit s is set if the sum s can be made. Adding a weight w makes every sum s+w possible, so the new set
+    is reachable | (reachable << w), which handles 64 sums per word operation.
+*/
+auto subset_sums(const vector<int> & weights, int c) -> vector<uint64_t> {
+    int words = (c+1 + 63) / 64;
+    vector<uint64_t> reachable(words, 0);
+    reachable[0] = 1;
+    for (int weight : weights) {
+        if (weight > c) {
+            continue;
+        }
+        int word_shift = weight / 64, bit_shift = weight % 64;
+        // Go from the top so that the words we read haven't been updated yet
+        for (int i = words-1; i >= word_shift; --i) {
+            uint64_t shifted = reachable[i - word_shift] << bit_shift;
+            if (bit_shift != 0 && i - word_shift - 1 >= 0) {
+                shifted |= reachable[i - word_shift - 1] >> (64 - bit_shift);
+            }
+            reachable[i] |= shifted;
+        }
+    }
+    // Clear the bits above c
+    if ((c+1) % 64 != 0) {
+        reachable[words-1] &= (uint64_t(1) << ((c+1) % 64)) - 1;
+    }
+    return reachable;
+}
+
+// The largest sum <= c that can be made from a subset of the weights
+auto max_subset_sum(const vector<int> & weights, int c) -> int {
+    vector<uint64_t> reachable = subset_sums(weights, c);
+    for (int i = reachable.size()-1; i >= 0; --i) {
+        if (reachable[i] != 0) {
+            return i * 64 + 63 - __builtin_clzll(reachable[i]);
+        }
+    }
+    return 0;
+}
+
+#ifdef BENCHMARK
+#include <chrono>
+#include <random>
+
+/*
+    Compile with -DBENCHMARK -pthread to time solve_knapsack on random objects with 1, 2, 4, ...
+    hardware threads for growing capacities. The chosen objects are compared to the ones of
+    the single threaded run, which they must be identical to.
+*/
+auto benchmark() -> void {
+    const int n = 100;
+    mt19937 rng(0);
+    int hardware = knapsack_threads;
+    cout << "capacity\tthreads\ttime (s)\tspeedup\tidentical\n";
+    for (int c : {1 << 16, 1 << 20, 1 << 23}) {
+        vector<pair<int, int>> objects(n);
+        for (auto & [value, weight] : objects) {
+            value = rng() % 1000000;
+            weight = 1 + rng() % (c / 8);
+        }
+        vector<int> serial;
+        double serial_time = 0;
+        for (int threads = 1; threads <= hardware; threads *= 2) {
+            knapsack_threads = threads;
+            auto start = chrono::steady_clock::now();
+            vector<int> indicies = solve_knapsack(n, c, objects);
+            double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (threads == 1) {
+                serial = indicies;
+                serial_time = elapsed;
+            }
+            cout << c << "\t" << threads << "\t" << elapsed << "\t" << serial_time / elapsed
+                << "\t" << (indicies == serial ? "yes" : "NO") << "\n";
+        }
+    }
+    knapsack_threads = hardware;
+}
+#endif
+
 auto main () -> int {
+#ifdef BENCHMARK
+    benchmark();
+    return 0;
+#endif
     int c, n;
     while (cin >> c >> n) {
         vector<pair<int, int>> objects(n);
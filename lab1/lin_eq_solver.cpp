@@ -8,6 +8,19 @@
 #include <limits>
 #include <fstream>
 #include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <tuple>
+#include <map>
+#include <set>
+#include <string>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define X86_KERNELS
+#endif
 
 using namespace std;
 
@@ -19,151 +32,1086 @@ auto equals(double a, double b) -> bool {
 }
 
 /*
-    Perform gaussian elimination to solve a linear system of equations given by an augmented matrix.
-    Aditiona
-    Assumes aug is a n * (n+1) sized matrix
-    Runs in O(n^3) because of the triple nested for loop when doing rref.
+    Dense matrix with the rows stored one after another in a single array,
+    so row i starts at data[i * cols].
+*/
+struct Matrix {
+    int rows, cols;
+    vector<double> data;
+
+    Matrix(int rows = 0, int cols = 0) : rows(rows), cols(cols), data(long(rows) * cols, 0) {}
+
+    auto operator[](int row) -> double * {
+        return data.data() + long(row) * cols;
+    }
+    auto operator[](int row) const -> const double * {
+        return data.data() + long(row) * cols;
+    }
+};
+
+/*
+    c[r][j] -= sum over k < depth of l[r][k] * u[k][j] for the 4 rows r and the columns j < width, where
+    c, l and u point to the top left corners in matrices with the given strides (they may be the same matrix).
+    The kernel keeps the sums of 4 rows by 4*VECTORS columns in vector registers, so every element of u
+    loaded is used 4 times and every element of l 4*VECTORS times. The generic version has room for
+    VECTORS = 1 in the 16 SSE registers, the AVX2 one for VECTORS = 2 in 4 lane registers with fma.
+*/
+typedef double Lanes __attribute__((vector_size(4 * sizeof(double))));
+
+template<int VECTORS>
+__attribute__((always_inline)) inline void update_strip(double * c, int c_stride, const double * l, int l_stride,
+    const double * u, int u_stride, int depth, int width) {
+
+    const int WIDTH = 4 * VECTORS;
+    double * rows[4] = {c, c + c_stride, c + 2L * c_stride, c + 3L * c_stride};
+    const double * l_rows[4] = {l, l + l_stride, l + 2L * l_stride, l + 3L * l_stride};
+    int j = 0;
+    for (; j + WIDTH <= width; j += WIDTH) {
+        Lanes sums[4][VECTORS];
+        #pragma GCC unroll 4
+        for (int r = 0; r < 4; ++r) {
+            for (int v = 0; v < VECTORS; ++v) {
+                memcpy(&sums[r][v], rows[r] + j + 4 * v, sizeof(Lanes));
+            }
+        }
+        for (int k = 0; k < depth; ++k) {
+            Lanes u_k[VECTORS];
+            for (int v = 0; v < VECTORS; ++v) {
+                memcpy(&u_k[v], u + long(k) * u_stride + j + 4 * v, sizeof(Lanes));
+            }
+            #pragma GCC unroll 4
+            for (int r = 0; r < 4; ++r) {
+                double l_rk = l_rows[r][k];
+                for (int v = 0; v < VECTORS; ++v) {
+                    sums[r][v] -= l_rk * u_k[v];
+                }
+            }
+        }
+        #pragma GCC unroll 4
+        for (int r = 0; r < 4; ++r) {
+            for (int v = 0; v < VECTORS; ++v) {
+                memcpy(rows[r] + j + 4 * v, &sums[r][v], sizeof(Lanes));
+            }
+        }
+    }
+    for (int r = 0; r < 4; ++r) {
+        for (int k = 0; k < depth; ++k) {
+            double l_rk = l_rows[r][k];
+            for (int jj = j; jj < width; ++jj) {
+                rows[r][jj] -= l_rk * u[long(k) * u_stride + jj];
+            }
+        }
+    }
+}
+
+using StripKernel = void (*)(double *, int, const double *, int, const double *, int, int, int);
+
+void update_strip_generic(double * c, int c_stride, const double * l, int l_stride,
+    const double * u, int u_stride, int depth, int width) {
+    update_strip<1>(c, c_stride, l, l_stride, u, u_stride, depth, width);
+}
+
+#ifdef X86_KERNELS
+__attribute__((target("avx2,fma")))
+void update_strip_avx2(double * c, int c_stride, const double * l, int l_stride,
+    const double * u, int u_stride, int depth, int width) {
+    update_strip<2>(c, c_stride, l, l_stride, u, u_stride, depth, width);
+}
+#endif
+
+auto select_strip_kernel() -> StripKernel {
+#ifdef X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return update_strip_avx2;
+    }
+#endif
+    return update_strip_generic;
+}
+
+const StripKernel update_strip_kernel = select_strip_kernel();
+
+/*
+    c -= l * u where c is rows * width, l is rows * depth and u is depth * width, given as pointers to their
+    top left corners like for update_strip. The columns are split in tiles of COLUMN_TILE so that the tile of u
+    stays in L2 while all the rows are updated by it.
+*/
+const int COLUMN_TILE = 256;
+
+void subtract_product(double * c, int c_stride, const double * l, int l_stride, const double * u, int u_stride,
+    int rows, int depth, int width) {
+
+    // A single column (one right hand side) is a dot product per row, which the kernel has no use for
+    if (width == 1) {
+        for (int i = 0; i < rows; ++i) {
+            double sum = 0;
+            for (int k = 0; k < depth; ++k) {
+                sum += l[long(i) * l_stride + k] * u[long(k) * u_stride];
+            }
+            c[long(i) * c_stride] -= sum;
+        }
+        return;
+    }
+    for (int tile = 0; tile < width; tile += COLUMN_TILE) {
+        int tile_width = min(COLUMN_TILE, width - tile);
+        int i = 0;
+        for (; i + 4 <= rows; i += 4) {
+            update_strip_kernel(c + long(i) * c_stride + tile, c_stride, l + long(i) * l_stride, l_stride,
+                u + tile, u_stride, depth, tile_width);
+        }
+        for (; i < rows; ++i) {
+            double * c_row = c + long(i) * c_stride + tile;
+            for (int k = 0; k < depth; ++k) {
+                double l_ik = l[long(i) * l_stride + k];
+                const double * u_row = u + long(k) * u_stride + tile;
+                for (int j = 0; j < tile_width; ++j) {
+                    c_row[j] -= l_ik * u_row[j];
+                }
+            }
+        }
+    }
+}
+
+// Starts the workers of lu_factor, which stay for the whole factorization, f(0) on the calling thread
+template<typename F>
+auto run_on_threads(int threads, F f) -> void {
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(f, t);
+    }
+    f(0);
+    for (thread & worker : workers) {
+        worker.join();
+    }
+}
+
+/*
+    The wait between the steps of lu_factor, several per column of a panel (after the pivot search,
+    after the swap, ...), so for n in the thousands it is passed tens of thousands of times and each
+    step in between is short. The threads spin on the generation instead of sleeping, yielding in case
+    there are more threads than cores. The thread that arrives last bumps the generation, and its
+    release store is what publishes the pivot and the updated rows to the others.
+*/
+struct SpinBarrier {
+    int threads;
+    atomic<int> arrived{0};
+    atomic<int> generation{0};
+
+    SpinBarrier(int threads) : threads(threads) {}
+
+    auto wait() -> void {
+        int current = generation.load(memory_order_acquire);
+        if (arrived.fetch_add(1, memory_order_acq_rel) == threads - 1) {
+            arrived.store(0, memory_order_relaxed);
+            generation.store(current + 1, memory_order_release);
+            return;
+        }
+        while (generation.load(memory_order_acquire) == current) {
+            this_thread::yield();
+        }
+    }
+};
+
+/*
+    Blocked LU factorization with partial pivoting, PA = LU.
+    The columns are handled LU_BLOCK at a time:
+    1. The panel (the block of columns from the diagonal down) is factored column by column, swapping
+       whole rows when pivoting.
+    2. The rows of U to the right of the panel are solved from the unit lower triangle of the panel.
+    3. The trailing matrix gets the update of the whole panel at once, A22 -= L21 * U12, which is a matrix
+       multiplication and where almost all of the 2n^3/3 flops are. Unlike the row at a time elimination
+       every element loaded there is used many times, see update_strip.
+
+    Factors the square matrix a in place, below the diagonal is L (whose diagonal is all ones) and from the
+    diagonal up is U. Row i of the factored matrix is row permutation[i] of the original.
+    Returns false if some column has no pivot (the matrix is singular), a is garbage then.
+
+    Matrices with at least PARALLEL_LU_MIN_SIZE rows are factored by lu_threads threads, which split every
+    step between them and wait for each other on a barrier in between:
+    - The pivot search is a reduction, every thread finds the largest element of its part of the column
+      and then every thread picks the same largest one of those (the first one on ties, like the serial search).
+    - The row swap, U12 and the update of the rest of the panel are split by columns or rows.
+    - The trailing update is split by rows, in multiples of the 4 rows of the kernel.
+    No element is computed differently than by one thread, so the factorization is bit-identical.
 */
-auto gauss_elim(vector<vector<double>> aug) -> pair<int, vector<double>> {
+const int LU_BLOCK = 64;
+const int PARALLEL_LU_MIN_SIZE = 256;
+int lu_threads = max(1u, thread::hardware_concurrency());
+
+auto lu_factor(Matrix & a, vector<int> & permutation) -> bool {
+    int n = a.rows;
+    permutation.resize(n);
+    for (int i = 0; i < n; ++i) {
+        permutation[i] = i;
+    }
+    int threads = n >= PARALLEL_LU_MIN_SIZE ? lu_threads : 1;
+    SpinBarrier barrier(threads);
+    vector<int> largest(threads);
+    bool factored = true;
+
+    // Part t of [begin, end) when it's split in threads parts, which are multiples of align long
+    auto part = [&](int begin, int end, int t, int align) -> pair<int, int> {
+        int chunk = ((end - begin + threads - 1) / threads + align - 1) / align * align;
+        int part_begin = min(begin + t * chunk, end);
+        return make_pair(part_begin, min(part_begin + chunk, end));
+    };
+
+    run_on_threads(threads, [&](int t) {
+        auto sync = [&]() {
+            if (threads > 1) {
+                barrier.wait();
+            }
+        };
+        for (int k_begin = 0; k_begin < n; k_begin += LU_BLOCK) {
+            int k_end = min(k_begin + LU_BLOCK, n);
+
+            for (int col = k_begin; col < k_end; ++col) {
+                auto [row_begin, row_end] = part(col, n, t, 1);
+                int local = row_begin;
+                for (int i = row_begin; i < row_end; ++i) {
+                    if (abs(a[i][col]) > abs(a[local][col])) {
+                        local = i;
+                    }
+                }
+                largest[t] = row_begin < row_end ? local : -1;
+                sync();
+                int pivot_index = col;
+                for (int s = 0; s < threads; ++s) {
+                    if (largest[s] != -1 && abs(a[largest[s]][col]) > abs(a[pivot_index][col])) {
+                        pivot_index = largest[s];
+                    }
+                }
+                if (equals(a[pivot_index][col], 0)) {
+                    // Every thread sees the same pivot, so they all stop here
+                    if (t == 0) {
+                        factored = false;
+                    }
+                    return;
+                }
+                sync();
+                if (pivot_index != col) {
+                    auto [col_begin, col_end] = part(0, n, t, 1);
+                    swap_ranges(a[col] + col_begin, a[col] + col_end, a[pivot_index] + col_begin);
+                    if (t == 0) {
+                        swap(permutation[col], permutation[pivot_index]);
+                    }
+                }
+                sync();
+                tie(row_begin, row_end) = part(col + 1, n, t, 1);
+                for (int i = row_begin; i < row_end; ++i) {
+                    double l = a[i][col] /= a[col][col];
+                    for (int j = col + 1; j < k_end; ++j) {
+                        a[i][j] -= l * a[col][j];
+                    }
+                }
+                sync();
+            }
+
+            auto [col_begin, col_end] = part(k_end, n, t, 1);
+            for (int row = k_begin + 1; row < k_end; ++row) {
+                for (int k = k_begin; k < row; ++k) {
+                    double l = a[row][k];
+                    for (int j = col_begin; j < col_end; ++j) {
+                        a[row][j] -= l * a[k][j];
+                    }
+                }
+            }
+            sync();
+            auto [row_begin, row_end] = part(k_end, n, t, 4);
+            subtract_product(a[row_begin] + k_end, n, a[row_begin] + k_begin, n, a[k_begin] + k_end, n,
+                row_end - row_begin, k_end - k_begin, n - k_end);
+            sync();
+        }
+    });
+    return factored;
+}
+
+/*
+    Solves LY = B in place for all the columns of b at once, L is the unit lower triangle of lu.
+    Like the factorization it goes LU_BLOCK rows at a time, solving the rows of the block by subtracting
+    earlier rows of the block, and then subtracts the whole block from the rows below as a matrix product.
+*/
+void forward_substitution(const Matrix & lu, Matrix & b) {
+    int n = lu.rows, m = b.cols;
+    for (int k_begin = 0; k_begin < n; k_begin += LU_BLOCK) {
+        int k_end = min(k_begin + LU_BLOCK, n);
+        for (int i = k_begin + 1; i < k_end; ++i) {
+            for (int k = k_begin; k < i; ++k) {
+                double l = lu[i][k];
+                for (int j = 0; j < m; ++j) {
+                    b[i][j] -= l * b[k][j];
+                }
+            }
+        }
+        subtract_product(b[k_end], m, lu[k_end] + k_begin, n, b[k_begin], m, n - k_end, k_end - k_begin, m);
+    }
+}
+
+// Solves UX = Y in place for all the columns of y at once, U is the upper triangle of lu. Blocked from the bottom up.
+void back_substitution(const Matrix & lu, Matrix & y) {
+    int n = lu.rows, m = y.cols;
+    for (int k_end = n; k_end > 0; k_end -= LU_BLOCK) {
+        int k_begin = max(k_end - LU_BLOCK, 0);
+        for (int i = k_end - 1; i >= k_begin; --i) {
+            for (int k = i + 1; k < k_end; ++k) {
+                double u = lu[i][k];
+                for (int j = 0; j < m; ++j) {
+                    y[i][j] -= u * y[k][j];
+                }
+            }
+            for (int j = 0; j < m; ++j) {
+                y[i][j] /= lu[i][i];
+            }
+        }
+        subtract_product(y[0], m, lu[0] + k_begin, n, y[k_begin], m, k_begin, k_end - k_begin, m);
+    }
+}
+
+/*
+    Brings the augmented matrix aug = [A | B] where A is n * n to reduced row echelon form, with the pivots
+    chosen in the columns of A.
+    Runs in O(n^2 * aug.cols) because of the triple nested for loop.
+*/
+void reduce_row_echelon(Matrix & aug) {
+    int n = aug.rows;
 
     /*
         We wish to transform each row one by one such that it's first non-zero
         element is in the column index equal to it's row index. Additionally we want all
-        element below and above this non-zero element(pivot) to be zero. 
-        This will give us a matrix on reduced row echelon form from which we can easily read out 
+        element below and above this non-zero element(pivot) to be zero.
+        This will give us a matrix on reduced row echelon form from which we can easily read out
         the solution.
     */
-    for (int col = 0, row = 0; col < aug.size() && row < aug.size(); ++col) {
+    for (int col = 0, row = 0; col < n && row < n; ++col) {
 
         /*
             Find the row with the greatest element in the position of the
             current rows pivot column.
         */
         int pivot_index = row;
-        for (int i = row; i < aug.size(); ++i) {
+        for (int i = row; i < n; ++i) {
             if (abs(aug[i][col]) > abs(aug[pivot_index][col])) {
                 pivot_index = i;
             }
         }
-        /* 
+        /*
             If no pivot element greater than 0 was found then the pivot of this
             row has to be the next column
         */
         if (equals(aug[pivot_index][col], 0)) {
             continue;
         }
-        /* 
+        /*
             If we found a pivot swap that row and the current one
         */
-        for (int i = col; i <= aug.size(); ++i) {
+        for (int i = col; i < aug.cols; ++i) {
             swap (aug[pivot_index][i], aug[row][i]);
         }
 
-        /* 
+        /*
             Reduce all elements below and above the pivot to 0 by subtracting the row multiplied by a factor
             to each row bellow it.
         */
-        for (int i = 0; i < aug.size(); ++i) {
+        for (int i = 0; i < n; ++i) {
             if (i != row) {
                 double c = aug[i][col] / aug[row][col];
-                for (int j = col; j <= aug.size(); ++j) {
+                for (int j = col; j < aug.cols; ++j) {
                     aug[i][j] -= aug[row][j] * c;
                 }
             }
         }
         ++row;
     }
+}
 
+/*
+    Factorization of a square matrix A, made once and then used to solve Ax = b for any number of b.
+    The result for every b is like gauss_elim: 1 if the solution is unique, 0 if the system is inconsistent
+    and -1 if there are multiple solutions, where the variables that aren't determined are infinity.
 
-    for (auto row : aug) {
-        for (auto x : row) {
-            cout << x << " ";
-        }
-        cout << endl;
+    If A is not singular it's the LU factorization and solving is a permutation of b followed by the
+    two triangular solves.
+    Otherwise we reduce [A | I] to [R | E], so that R = EA is the reduced row echelon form of A and E is
+    every row operation done to get there. Solving Ax = b is then reading the solution out of [R | Eb], which is
+    what the elimination of [A | b] would have given.
+*/
+struct LUFactorization {
+    int n;
+    bool singular;
+    Matrix lu;
+    vector<int> permutation;
+    Matrix reduced;
 
+    LUFactorization(const Matrix & a) : n(a.rows), lu(a) {
+        singular = !lu_factor(lu, permutation);
+        if (singular) {
+            lu = Matrix();
+            reduced = Matrix(n, 2*n);
+            for (int i = 0; i < n; ++i) {
+                copy(a[i], a[i] + n, reduced[i]);
+                reduced[i][n + i] = 1;
+            }
+            reduce_row_echelon(reduced);
+        }
     }
 
     /*
-        Go row for row and read out the isolated pivot variable if possible
-        If there is no pivot and rhs is non zero then we have no solutions
-        If there are two variables in the lhs we have multiple.
+        Solves for every column of b (which is n * m), returns the number of solutions for every column
+        and the solutions as the columns of a n * m matrix.
     */
-    vector<double> solution(aug.size(), numeric_limits<double>::infinity());
-    bool inconsistent = false, multiple = false;
-    for (int i=0; i < aug.size(); ++i) {
-        int e = 0;
-        int piv = 0;
-        for (int j = 0; j < aug.size(); ++j) {
-            if (!equals(aug[i][j], 0)) {
-                if (e == 0) {
-                    piv = j;
+    auto solve(const Matrix & b) const -> pair<vector<int>, Matrix> {
+        int m = b.cols;
+        Matrix x(n, m);
+        if (!singular) {
+            for (int i = 0; i < n; ++i) {
+                copy(b[permutation[i]], b[permutation[i]] + m, x[i]);
+            }
+            forward_substitution(lu, x);
+            back_substitution(lu, x);
+            return make_pair(vector<int>(m, 1), x);
+        }
+
+        // y = Eb, the right hand sides after the row operations
+        Matrix y(n, m);
+        for (int i = 0; i < n; ++i) {
+            for (int k = 0; k < n; ++k) {
+                double e = reduced[i][n + k];
+                if (e != 0) {
+                    for (int j = 0; j < m; ++j) {
+                        y[i][j] += e * b[k][j];
+                    }
                 }
-                e++;
             }
         }
-        if (e == 1) {
-            solution[piv] = aug[i][aug.size()] / aug[i][piv];
+        fill(x.data.begin(), x.data.end(), numeric_limits<double>::infinity());
+        vector<int> nr_of_solutions(m, 1);
+
+        /*
+            Go row for row and read out the isolated pivot variable if possible
+            If there is no pivot and rhs is non zero then we have no solutions
+            If there are two variables in the lhs we have multiple.
+        */
+        bool multiple = false;
+        vector<bool> inconsistent(m, false);
+        for (int i = 0; i < n; ++i) {
+            int e = 0;
+            int piv = 0;
+            for (int j = 0; j < n; ++j) {
+                if (!equals(reduced[i][j], 0)) {
+                    if (e == 0) {
+                        piv = j;
+                    }
+                    e++;
+                }
+            }
+            for (int j = 0; j < m; ++j) {
+                if (e == 1) {
+                    x[piv][j] = y[i][j] / reduced[i][piv];
+                }
+                if (e == 0 && !equals(y[i][j], 0)) {
+                    inconsistent[j] = true;
+                }
+            }
+            if (e > 1) {
+                multiple = true;
+            }
         }
-        if (e == 0) {
-            if (!equals(aug[i][aug.size()], 0)) {
-                inconsistent = true;
+        for (int j = 0; j < m; ++j) {
+            if (inconsistent[j]) {
+                nr_of_solutions[j] = 0;
+            }
+            else if (multiple) {
+                nr_of_solutions[j] = -1;
             }
         }
-        if (e > 1) {
-            multiple = true;
+        return make_pair(nr_of_solutions, x);
+    }
+};
+
+/*
+    Solves ax = b, returns 1 and the solution if it's unique, 0 if the system is inconsistent and -1 if there
+    are multiple solutions, where the variables that aren't determined are infinity.
+*/
+auto gauss_elim(const Matrix & a, const vector<double> & b) -> pair<int, vector<double>> {
+    Matrix column(b.size(), 1);
+    copy(b.begin(), b.end(), column.data.begin());
+    auto [nr_of_solutions, x] = LUFactorization(a).solve(column);
+    return make_pair(nr_of_solutions[0], x.data);
+}
+
+/*
+    Sparse matrix in compressed sparse row form, the nonzero elements of row i are
+    values[row_begin[i], row_begin[i+1]) and are in the columns with the same indices in columns, in
+    increasing order.
+*/
+struct SparseMatrix {
+    int n;
+    vector<int> row_begin, columns;
+    vector<double> values;
+
+    // From (row, column, value) triplets in any order, the values of repeated elements are added
+    SparseMatrix(int n, vector<tuple<int, int, double>> elements) : n(n), row_begin(n+1, 0) {
+        sort(elements.begin(), elements.end());
+        for (int e = 0; e < (int)elements.size(); ++e) {
+            auto [row, column, value] = elements[e];
+            if (e > 0 && get<0>(elements[e-1]) == row && get<1>(elements[e-1]) == column) {
+                values.back() += value;
+                continue;
+            }
+            columns.push_back(column);
+            values.push_back(value);
+            row_begin[row+1]++;
+        }
+        for (int i = 0; i < n; ++i) {
+            row_begin[i+1] += row_begin[i];
         }
     }
-    
-    if (inconsistent) {
-        return make_pair(0, solution);
+
+    SparseMatrix(const Matrix & a) : n(a.rows), row_begin(n+1, 0) {
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                if (a[i][j] != 0) {
+                    columns.push_back(j);
+                    values.push_back(a[i][j]);
+                }
+            }
+            row_begin[i+1] = columns.size();
+        }
     }
-    else if (multiple) {
-        return make_pair(-1, solution);
+
+    // y = Ax
+    void multiply(const vector<double> & x, vector<double> & y) const {
+        for (int i = 0; i < n; ++i) {
+            double sum = 0;
+            for (int e = row_begin[i]; e < row_begin[i+1]; ++e) {
+                sum += values[e] * x[columns[e]];
+            }
+            y[i] = sum;
+        }
     }
-    else {
-        return make_pair(1, solution);
+
+    auto element(int row, int column) const -> double {
+        auto begin = columns.begin() + row_begin[row], end = columns.begin() + row_begin[row+1];
+        auto it = lower_bound(begin, end, column);
+        return it != end && *it == column ? values[it - columns.begin()] : 0;
     }
+
+    auto is_symmetric() const -> bool {
+        for (int i = 0; i < n; ++i) {
+            for (int e = row_begin[i]; e < row_begin[i+1]; ++e) {
+                if (!equals(values[e], element(columns[e], i))) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+auto dot(const vector<double> & x, const vector<double> & y) -> double {
+    double sum = 0;
+    for (int i = 0; i < (int)x.size(); ++i) {
+        sum += x[i] * y[i];
+    }
+    return sum;
 }
 
-auto main() -> int {
-    int n;
-    while (true) {
-        cin >> n;
-        if (!n) { break; }
+/*
+    The iterative solvers stop when |b - Ax| <= ITERATIVE_TOLERANCE * |b|, or give up after
+    MAX_ITERATIONS (or n if that's more) iterations. Both are preconditioned by the inverse of the
+    diagonal (Jacobi), which costs nothing and evens out rows of very different scales.
+*/
+const double ITERATIVE_TOLERANCE = 1e-12;
+const int MAX_ITERATIONS = 1000;
+
+/*
+    Preconditioned conjugate gradient, only for symmetric positive definite matrices. Returns false if
+    it didn't converge or found out that the matrix isn't positive definite.
+*/
+auto conjugate_gradient(const SparseMatrix & a, const vector<double> & b, vector<double> & x) -> bool {
+    int n = a.n;
+    vector<double> inverse_diagonal(n);
+    for (int i = 0; i < n; ++i) {
+        double diagonal = a.element(i, i);
+        if (diagonal <= 0) {
+            return false;
+        }
+        inverse_diagonal[i] = 1 / diagonal;
+    }
+    double limit = ITERATIVE_TOLERANCE * sqrt(dot(b, b));
+    x.assign(n, 0);
+    vector<double> r = b, z(n), p(n), ap(n);
+    for (int i = 0; i < n; ++i) {
+        p[i] = z[i] = inverse_diagonal[i] * r[i];
+    }
+    double rz = dot(r, z);
+    for (int iteration = 0; iteration < max(MAX_ITERATIONS, n); ++iteration) {
+        if (sqrt(dot(r, r)) <= limit) {
+            return true;
+        }
+        a.multiply(p, ap);
+        double pap = dot(p, ap);
+        if (pap <= 0) {
+            return false;
+        }
+        double alpha = rz / pap;
+        for (int i = 0; i < n; ++i) {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * ap[i];
+            z[i] = inverse_diagonal[i] * r[i];
+        }
+        double next_rz = dot(r, z);
+        for (int i = 0; i < n; ++i) {
+            p[i] = z[i] + next_rz / rz * p[i];
+        }
+        rz = next_rz;
+    }
+    return sqrt(dot(r, r)) <= limit;
+}
 
-        vector<vector<double>> aug(n, vector<double>(n));
+/*
+    Preconditioned BiCGSTAB for any nonsingular matrix. Returns false if it didn't converge or broke down.
+*/
+auto bicgstab(const SparseMatrix & a, const vector<double> & b, vector<double> & x) -> bool {
+    int n = a.n;
+    vector<double> inverse_diagonal(n);
+    for (int i = 0; i < n; ++i) {
+        double diagonal = a.element(i, i);
+        inverse_diagonal[i] = diagonal != 0 ? 1 / diagonal : 1;
+    }
+    double limit = ITERATIVE_TOLERANCE * sqrt(dot(b, b));
+    x.assign(n, 0);
+    vector<double> r = b, r0 = b, p(n, 0), v(n, 0), y(n), s(n), z(n), t(n);
+    double rho = 1, alpha = 1, omega = 1;
+    for (int iteration = 0; iteration < max(MAX_ITERATIONS, n); ++iteration) {
+        if (sqrt(dot(r, r)) <= limit) {
+            return true;
+        }
+        double next_rho = dot(r0, r);
+        if (next_rho == 0 || omega == 0) {
+            return false;
+        }
+        double beta = next_rho / rho * (alpha / omega);
+        rho = next_rho;
         for (int i = 0; i < n; ++i) {
-            for (int j = 0; j < n; ++j) {
-                cin >> aug[i][j];
-            }
+            p[i] = r[i] + beta * (p[i] - omega * v[i]);
+            y[i] = inverse_diagonal[i] * p[i];
+        }
+        a.multiply(y, v);
+        double r0v = dot(r0, v);
+        if (r0v == 0) {
+            return false;
         }
+        alpha = rho / r0v;
         for (int i = 0; i < n; ++i) {
-            double vec_i;
-            cin >> vec_i;
-            aug[i].push_back(vec_i);
+            s[i] = r[i] - alpha * v[i];
+            z[i] = inverse_diagonal[i] * s[i];
         }
-        stringstream output;
-        auto [nr_of_solutions, solution] = gauss_elim(aug);
-        if (nr_of_solutions == 0) {
-            file << "inconsistent\n";
+        a.multiply(z, t);
+        double tt = dot(t, t);
+        omega = tt != 0 ? dot(t, s) / tt : 0;
+        for (int i = 0; i < n; ++i) {
+            x[i] += alpha * y[i] + omega * z[i];
+            r[i] = s[i] - omega * t[i];
         }
-        else  if (nr_of_solutions == -1) {
-            for (auto x : solution) {
-                if (x != numeric_limits<double>::infinity())  {
-                    output << setprecision(3) << fixed << x << " ";
+    }
+    return sqrt(dot(r, r)) <= limit;
+}
+
+/*
+    Sparse gaussian elimination. The rows are kept as sorted (column, value) lists and for every column we
+    keep the rows that have an element in it, so that eliminating a column only touches those rows.
+    The order of the columns and the pivots are chosen as we go to keep the fill in low (Markowitz):
+    - The next column is the one with fewest elements left in the rows that aren't pivots yet, since every
+      one of them gets the elements of the pivot row added.
+    - The pivot is chosen by threshold partial pivoting, among the rows whose element is at least
+      SPARSE_PIVOT_THRESHOLD times the largest one we take the diagonal one or else the one with fewest
+      elements. That's stable enough and fills in much less than always taking the largest.
+    Like for the dense matrices a column without a pivot (larger than 1e-9) belongs to a free variable, so the
+    pivot rows end up on row echelon form and the rows that weren't used are all zero.
+
+    Then every pivot variable is solved from the last pivot to the first as a constant plus a combination of
+    the free variables. It's determined if that combination is empty. The result is reported like gauss_elim.
+*/
+const double SPARSE_PIVOT_THRESHOLD = 0.1;
+
+auto sparse_lu_solve(const SparseMatrix & a, const vector<double> & b) -> pair<int, vector<double>> {
+    int n = a.n;
+    vector<vector<pair<int, double>>> rows(n);
+    vector<vector<int>> column_rows(n);
+    vector<int> column_count(n, 0);
+    for (int i = 0; i < n; ++i) {
+        for (int e = a.row_begin[i]; e < a.row_begin[i+1]; ++e) {
+            if (a.values[e] != 0) {
+                rows[i].push_back(make_pair(a.columns[e], a.values[e]));
+                column_rows[a.columns[e]].push_back(i);
+                column_count[a.columns[e]]++;
+            }
+        }
+    }
+    // The columns left by the number of elements they have in the rows that aren't pivots
+    set<pair<int, int>> columns_left;
+    for (int j = 0; j < n; ++j) {
+        columns_left.insert(make_pair(column_count[j], j));
+    }
+    auto add_to_count = [&](int column, int delta) {
+        if (columns_left.erase(make_pair(column_count[column], column))) {
+            column_count[column] += delta;
+            columns_left.insert(make_pair(column_count[column], column));
+        }
+    };
+
+    vector<double> rhs = b;
+    vector<bool> active(n, true);
+    vector<int> pivot_row(n, -1); // The row which has the pivot of the column, or -1 for free columns
+    vector<int> pivot_order;
+    vector<int> seen(n, -1);
+
+    auto find = [&](int row, int column) -> vector<pair<int, double>>::iterator {
+        return lower_bound(rows[row].begin(), rows[row].end(), make_pair(column, -numeric_limits<double>::infinity()));
+    };
+
+    while (!columns_left.empty()) {
+        int column = columns_left.begin()->second;
+        columns_left.erase(columns_left.begin());
+
+        vector<int> candidates;
+        double largest = 0;
+        for (int row : column_rows[column]) {
+            if (!active[row] || seen[row] == column) {
+                continue;
+            }
+            seen[row] = column;
+            auto it = find(row, column);
+            if (it != rows[row].end() && it->first == column) {
+                candidates.push_back(row);
+                largest = max(largest, abs(it->second));
+            }
+        }
+        column_rows[column] = vector<int>();
+        if (equals(largest, 0)) {
+            continue;
+        }
+        // The diagonal element is preferred if it's large enough, which keeps a symmetric structure symmetric
+        int pivot = -1;
+        for (int row : candidates) {
+            if (abs(find(row, column)->second) < SPARSE_PIVOT_THRESHOLD * largest) {
+                continue;
+            }
+            if (pivot == -1 || row == column || (pivot != column && rows[row].size() < rows[pivot].size())) {
+                pivot = row;
+            }
+        }
+        active[pivot] = false;
+        pivot_row[column] = pivot;
+        pivot_order.push_back(column);
+        for (auto [j, value] : rows[pivot]) {
+            add_to_count(j, -1);
+        }
+        double pivot_value = find(pivot, column)->second;
+
+        // rows[row] -= factor * rows[pivot], where factor makes the element in the pivot column exactly 0
+        for (int row : candidates) {
+            if (row == pivot) {
+                continue;
+            }
+            double factor = find(row, column)->second / pivot_value;
+            const vector<pair<int, double>> & pivot_elements = rows[pivot];
+            vector<pair<int, double>> merged;
+            merged.reserve(rows[row].size() + pivot_elements.size());
+            auto it = rows[row].begin();
+            auto pivot_it = pivot_elements.begin();
+            while (it != rows[row].end() || pivot_it != pivot_elements.end()) {
+                if (pivot_it == pivot_elements.end() || (it != rows[row].end() && it->first < pivot_it->first)) {
+                    merged.push_back(*it++);
+                }
+                else if (it == rows[row].end() || pivot_it->first < it->first) {
+                    merged.push_back(make_pair(pivot_it->first, -factor * pivot_it->second));
+                    column_rows[pivot_it->first].push_back(row);
+                    add_to_count(pivot_it->first, 1);
+                    ++pivot_it;
                 }
                 else {
-                    output << "? ";
+                    if (it->first != column) {
+                        merged.push_back(make_pair(it->first, it->second - factor * pivot_it->second));
+                    }
+                    ++it, ++pivot_it;
+                }
+            }
+            rows[row] = move(merged);
+            rhs[row] -= factor * rhs[pivot];
+        }
+    }
+
+    /*
+        The rows without a pivot only have (almost) zero elements left, so if the right hand side
+        isn't zero there are no solutions.
+    */
+    vector<double> solution(n, numeric_limits<double>::infinity());
+    for (int i = 0; i < n; ++i) {
+        if (active[i] && !equals(rhs[i], 0)) {
+            return make_pair(0, solution);
+        }
+    }
+
+    // x[column] = constant[column] + sum of depends[column][f] * x[f] over the free variables f
+    vector<double> constant(n, 0);
+    vector<map<int, double>> depends(n);
+    bool multiple = false;
+    for (int k = pivot_order.size() - 1; k >= 0; --k) {
+        int column = pivot_order[k], row = pivot_row[column];
+        double pivot_value = 0;
+        constant[column] = rhs[row];
+        for (auto [j, value] : rows[row]) {
+            if (j == column) {
+                pivot_value = value;
+            }
+            else if (pivot_row[j] == -1) {
+                depends[column][j] -= value;
+            }
+            else {
+                constant[column] -= value * constant[j];
+                for (auto [f, coefficient] : depends[j]) {
+                    depends[column][f] -= value * coefficient;
                 }
             }
-            file << output.str() << endl;
         }
-        else if (nr_of_solutions == 1) {
-            for (auto x : solution) {
+        constant[column] /= pivot_value;
+        for (auto it = depends[column].begin(); it != depends[column].end();) {
+            it->second /= pivot_value;
+            it = equals(it->second, 0) ? depends[column].erase(it) : next(it);
+        }
+        if (depends[column].empty()) {
+            solution[column] = constant[column];
+        }
+        else {
+            multiple = true;
+        }
+    }
+    return make_pair(multiple ? -1 : 1, solution);
+}
+
+/*
+    Solves ax = b for a sparse a, reported like gauss_elim.
+    SparseSolver::LU uses sparse_lu_solve.
+    SparseSolver::Iterative uses conjugate gradient if a is symmetric and else BiCGSTAB (or if conjugate
+    gradient fails). Those only find a solution, so they are for matrices known to be nonsingular, and if
+    they don't converge the system is solved by sparse_lu_solve instead, which also tells why.
+*/
+enum class SparseSolver { LU, Iterative };
+
+auto sparse_solve(const SparseMatrix & a, const vector<double> & b,
+    SparseSolver solver = SparseSolver::LU) -> pair<int, vector<double>> {
+
+    if (solver == SparseSolver::Iterative) {
+        vector<double> x;
+        if ((a.is_symmetric() && conjugate_gradient(a, b, x)) || bicgstab(a, b, x)) {
+            return make_pair(1, x);
+        }
+    }
+    return sparse_lu_solve(a, b);
+}
+
+/*
+    Systems with at least SPARSE_MIN_SIZE variables where at most SPARSE_MAX_DENSITY of the coefficients
+    are nonzero are solved as sparse matrices.
+*/
+const int SPARSE_MIN_SIZE = 500;
+const double SPARSE_MAX_DENSITY = 0.01;
+
+#ifdef BENCHMARK
+#include <chrono>
+#include <random>
+
+/*
+    Compile with -DBENCHMARK -pthread to time the factorization and the solves on random (well conditioned)
+    systems. The factorization is reported in GFLOP/s as 2n^3/3 flops per second, the solves for
+    RIGHT_HAND_SIDES columns as 2n^2 flops per column, both as one batch and one column at a time
+    (for the first COLUMN_SOLVES columns).
+    The largest residual |Ax - b| of the batch is a sanity check.
+*/
+const int RIGHT_HAND_SIDES = 1000, COLUMN_SOLVES = 100;
+
+auto benchmark() -> void {
+    mt19937 rng(0);
+    uniform_real_distribution<double> uniform(-1, 1);
+    int m = RIGHT_HAND_SIDES;
+    cout << "n\tfactor (s)\tGFLOP/s\tbatch solve (s)\tGFLOP/s\tcolumn solves (s)\tGFLOP/s\tresidual\n";
+    for (int n = 250; n <= 4000; n *= 2) {
+        Matrix a(n, n), b(n, m);
+        for (double & x : a.data) {
+            x = uniform(rng);
+        }
+        for (double & x : b.data) {
+            x = uniform(rng);
+        }
+        auto start = chrono::steady_clock::now();
+        LUFactorization factorization(a);
+        double factor_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        Matrix x = factorization.solve(b).second;
+        double batch_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        Matrix column(n, 1);
+        for (int j = 0; j < COLUMN_SOLVES; ++j) {
+            for (int i = 0; i < n; ++i) {
+                column[i][0] = b[i][j];
+            }
+            factorization.solve(column);
+        }
+        double column_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        double residual = 0;
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < m; j += m / 10) {
+                double sum = -b[i][j];
+                for (int k = 0; k < n; ++k) {
+                    sum += a[i][k] * x[k][j];
+                }
+                residual = max(residual, abs(sum));
+            }
+        }
+        double solve_flops = 2.0 * n * n * m;
+        cout << n << "\t" << factor_time << "\t" << 2.0 * n * n * n / 3 / factor_time / 1e9
+            << "\t" << batch_time << "\t" << solve_flops / batch_time / 1e9
+            << "\t" << column_time << "\t" << 2.0 * n * n * COLUMN_SOLVES / column_time / 1e9 << "\t" << residual << "\n";
+    }
+}
+
+/*
+    Scaling of the factorization from one thread to all of them (1, 2, 4, ... and the number of hardware
+    threads) for n from 1000 to 8000. Every factorization is compared to the one thread one by a hash of its
+    bits, since the split between the threads mustn't change the result.
+*/
+auto factorization_hash(const Matrix & lu) -> uint64_t {
+    uint64_t hash = 0;
+    for (double x : lu.data) {
+        uint64_t bits;
+        memcpy(&bits, &x, sizeof(bits));
+        hash = (hash ^ bits) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+auto scaling_benchmark() -> void {
+    mt19937 rng(0);
+    uniform_real_distribution<double> uniform(-1, 1);
+    int hardware = lu_threads;
+    vector<int> thread_counts;
+    for (int threads = 1; threads < hardware; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(hardware);
+
+    cout << "n\tthreads\tfactor (s)\tGFLOP/s\tspeedup\tidentical\n";
+    for (int n = 1000; n <= 8000; n *= 2) {
+        Matrix a(n, n);
+        for (double & x : a.data) {
+            x = uniform(rng);
+        }
+        double serial_time = 0;
+        uint64_t serial_hash = 0;
+        for (int threads : thread_counts) {
+            lu_threads = threads;
+            Matrix lu = a;
+            vector<int> permutation;
+            auto start = chrono::steady_clock::now();
+            lu_factor(lu, permutation);
+            double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            uint64_t hash = factorization_hash(lu);
+            if (threads == 1) {
+                serial_time = elapsed;
+                serial_hash = hash;
+            }
+            cout << n << "\t" << threads << "\t" << elapsed << "\t" << 2.0 * n * n * n / 3 / elapsed / 1e9
+                << "\t" << serial_time / elapsed << "\t" << (hash == serial_hash ? "yes" : "NO") << "\n";
+        }
+    }
+    lu_threads = hardware;
+}
+#endif
+
+/*
+    Large sparse systems can't be given as a dense matrix (a system with 10^5 variables would be 10^10
+    numbers), so a case may instead start with the word sparse and give the nonzero coefficients as
+    (row, column, value) triplets, 0-indexed and in any order (repeated elements are added):
+        sparse n m
+        row column value    (m lines)
+        b_0 ... b_n-1
+    Such systems are built directly as a SparseMatrix and always solved by sparse_solve.
+*/
+auto read_sparse_system(istream & in) -> pair<SparseMatrix, vector<double>> {
+    int n;
+    long m;
+    in >> n >> m;
+    vector<tuple<int, int, double>> elements(m);
+    for (auto & [row, column, value] : elements) {
+        in >> row >> column >> value;
+    }
+    vector<double> b(n);
+    for (int i = 0; i < n; ++i) {
+        in >> b[i];
+    }
+    return make_pair(SparseMatrix(n, move(elements)), b);
+}
+
+auto print_solution(int nr_of_solutions, const vector<double> & solution) -> void {
+    stringstream output;
+    if (nr_of_solutions == 0) {
+        file << "inconsistent\n";
+    }
+    else  if (nr_of_solutions == -1) {
+        for (auto x : solution) {
+            if (x != numeric_limits<double>::infinity())  {
                 output << setprecision(3) << fixed << x << " ";
             }
-            file << output.str() << endl;
+            else {
+                output << "? ";
+            }
+        }
+        file << output.str() << endl;
+    }
+    else if (nr_of_solutions == 1) {
+        for (auto x : solution) {
+            output << setprecision(3) << fixed << x << " ";
+        }
+        file << output.str() << endl;
+    }
+}
+
+auto main() -> int {
+#ifdef BENCHMARK
+    benchmark();
+    scaling_benchmark();
+    return 0;
+#endif
+    string first;
+    while (cin >> first) {
+        if (first == "sparse") {
+            auto [a, b] = read_sparse_system(cin);
+            auto [nr_of_solutions, solution] = sparse_solve(a, b);
+            print_solution(nr_of_solutions, solution);
+            continue;
+        }
+        int n = stoi(first);
+        if (!n) { break; }
+
+        Matrix a(n, n);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                cin >> a[i][j];
+            }
+        }
+        vector<double> b(n);
+        for (int i = 0; i < n; ++i) {
+            cin >> b[i];
         }
+        long nonzero = count_if(a.data.begin(), a.data.end(), [](double x) { return x != 0; });
+        bool sparse = n >= SPARSE_MIN_SIZE && nonzero <= SPARSE_MAX_DENSITY * n * n;
+        auto [nr_of_solutions, solution] = sparse ? sparse_solve(SparseMatrix(a), b) : gauss_elim(a, b);
+        print_solution(nr_of_solutions, solution);
     }
     return 0;
 }
\ No newline at end of file
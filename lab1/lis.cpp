@@ -6,79 +6,522 @@
 #include <algorithm>
 #include <sstream>
 #include <limits>
+#include <thread>
+#include <atomic>
 
 using namespace std;
 
-// Struct used for aux vector 
-struct Previous {
-    Previous* p;
-    int index;
+/*
+    Increasing asks for every element to be greater than the one before, NonDecreasing for greater or equal.
+*/
+enum class Order { Increasing, NonDecreasing };
+
+/*
+    The first position in tails[0, len) whose value is >= x (Increasing) or > x (NonDecreasing), which
+    is where x goes since tails is sorted.
+    The search halves the range without branching on the comparison (it becomes a conditional move),
+    so there are no mispredictions to pay for, which for random sequences would be every other step.
+*/
+template<Order ORDER>
+inline auto pile_search(const int * tails, int len, int x) -> int {
+    if (len == 0) {
+        return 0;
+    }
+    const int * base = tails;
+    while (len > 1) {
+        int half = len / 2;
+        bool right = ORDER == Order::Increasing ? base[half - 1] < x : base[half - 1] <= x;
+        base += right ? half : 0;
+        len -= half;
+    }
+    bool after = ORDER == Order::Increasing ? *base < x : *base <= x;
+    return base - tails + after;
+}
+
+// Starts the chunk workers of LisEngine::find_levels, f(0) on the calling thread
+template<typename F>
+auto run_on_threads(int threads, F f) -> void {
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(f, t);
+    }
+    f(0);
+    for (thread & worker : workers) {
+        worker.join();
+    }
+}
+
+/*
+    Sequences of at least PARALLEL_LIS_MIN_SIZE elements are solved on lis_threads threads (see
+    LisEngine::find_levels) if it is set above 1. It is 1 unless changed: peeling levels costs 5-7 times
+    as much per element as the serial patience sort, and no machine it was measured on had enough cores to
+    make up for that, so the parallel path is opt-in.
+    A round costs every thread a hand-over to the next one however few elements it finds, so at round
+    PIPELINE_CHECK_ROUND (and every power of two after it) the threads give up and leave the rest to the
+    serial patience sort if the rounds so far found less than PIPELINE_MIN_ROUND_WORK elements each on
+    average. That is the case for sequences with a very long lis, which are close to sorted.
+*/
+const int PARALLEL_LIS_MIN_SIZE = 1 << 20;
+const int PIPELINE_CHUNKS_PER_THREAD = 16;
+const int PIPELINE_CHECK_ROUND = 1 << 12;
+const long PIPELINE_MIN_ROUND_WORK = 64;
+int lis_threads = 1;
+
+/*
+    Hands the running minimums from one thread to the next (see LisEngine::find_levels), a ring of
+    PIPELINE_DEPTH values with one writer and one reader. The writer may get that many values
+    ahead before it has to wait. The release of sent (received) publishes the value (the free slot).
+    No thread gets more than a round ahead of the one after it, so a pipe never holds more than two
+    rounds of values, 2 * PIPELINE_CHUNKS_PER_THREAD, and a full pipe only means a slow reader.
+    Waiting gives up, returning false, when stop is raised.
+*/
+const int PIPELINE_DEPTH = 1024;
+static_assert(PIPELINE_DEPTH > 2 * PIPELINE_CHUNKS_PER_THREAD, "the pipes would deadlock");
+
+struct RoundPipe {
+    long values[PIPELINE_DEPTH];
+    alignas(64) atomic<long> sent{0};
+    alignas(64) atomic<long> received{0};
+
+    auto send(long value, const atomic<bool> & stop) -> bool {
+        long count = sent.load(memory_order_relaxed);
+        while (count - received.load(memory_order_acquire) == PIPELINE_DEPTH) {
+            if (stop.load(memory_order_relaxed)) {
+                return false;
+            }
+            this_thread::yield();
+        }
+        values[count % PIPELINE_DEPTH] = value;
+        sent.store(count + 1, memory_order_release);
+        return true;
+    }
+
+    auto receive(long & value, const atomic<bool> & stop) -> bool {
+        long count = received.load(memory_order_relaxed);
+        while (sent.load(memory_order_acquire) == count) {
+            if (stop.load(memory_order_relaxed)) {
+                return false;
+            }
+            this_thread::yield();
+        }
+        value = values[count % PIPELINE_DEPTH];
+        received.store(count + 1, memory_order_release);
+        return true;
+    }
+};
+
+/*
+    The level of an element is the length of the longest subsequence ending with it. The elements of level 1
+    are those no earlier element is smaller than (for NonDecreasing: smaller than or equal to), i.e. the
+    ones at most (less than) the running minimum of the elements before them. Removing them, the elements of
+    level 2 are found the same way among the rest, and so on.
+
+    LevelTree finds the elements of one level in a chunk [begin, end) of the sequence. It is a tournament
+    tree of the minimum of the remaining elements, whose leaves are blocks of LIS_LEAF elements scanned
+    linearly. A subtree is only entered if its minimum can be at most the running minimum before it,
+    in which case at least one element of it is found, so a round costs O(found * (LIS_LEAF + log n)).
+    Removed elements are the ones with a level, empty subtrees have the minimum EMPTY.
+*/
+const int LIS_LEAF = 16;
+
+template<Order ORDER>
+struct LevelTree {
+    static constexpr long EMPTY = numeric_limits<long>::max();
+    // The running minimum before the first element, every int but not EMPTY qualifies against it
+    static constexpr long OPEN = long(numeric_limits<int>::max()) + 1;
+
+    const int * sequence;
+    int * level;
+    int begin, end, size;
+    vector<long> mins;
+
+    LevelTree(const int * sequence, int * level, int begin, int end)
+        : sequence(sequence), level(level), begin(begin), end(end) {
+        int blocks = (end - begin + LIS_LEAF - 1) / LIS_LEAF;
+        size = 1;
+        while (size < blocks) {
+            size *= 2;
+        }
+        mins.assign(2 * size, EMPTY);
+        for (int i = begin; i < end; ++i) {
+            long & block = mins[size + (i - begin) / LIS_LEAF];
+            block = min(block, long(sequence[i]));
+        }
+        for (int node = size - 1; node >= 1; --node) {
+            mins[node] = min(mins[2 * node], mins[2 * node + 1]);
+        }
+    }
+
+    static auto qualifies(long x, long running) -> bool {
+        return ORDER == Order::Increasing ? x <= running : x < running;
+    }
+
+    auto minimum() const -> long {
+        return mins[1];
+    }
+
+    /*
+        Gives the remaining elements under node which qualify against the running minimum (of the remaining
+        elements) before them the level r and returns how many they were. The minimums from before the
+        round are what the running minimum is made of, the removed elements are among them.
+    */
+    auto peel(int node, long running, int r) -> long {
+        if (!qualifies(mins[node], running)) {
+            return 0;
+        }
+        long found = 0;
+        if (node >= size) {
+            int first = begin + (node - size) * LIS_LEAF, last = min(first + LIS_LEAF, end);
+            long remaining = EMPTY;
+            for (int i = first; i < last; ++i) {
+                if (level[i] != 0) {
+                    continue;
+                }
+                long x = sequence[i];
+                if (qualifies(x, running)) {
+                    level[i] = r;
+                    ++found;
+                }
+                else {
+                    remaining = min(remaining, x);
+                }
+                running = min(running, x);
+            }
+            mins[node] = remaining;
+            return found;
+        }
+        long left = mins[2 * node];
+        found += peel(2 * node, running, r);
+        found += peel(2 * node + 1, min(running, left), r);
+        mins[node] = min(mins[2 * node], mins[2 * node + 1]);
+        return found;
+    }
 };
 
 /*
     Algorithm: Use patient sort to find the lis of a sequence with a time complexity of O(nlog(n))
+
+    The engine keeps its arrays between calls, so after the first few cases solving doesn't allocate at all:
+    tails[k] is the top of pile k (the smallest last element of an increasing subsequence of length k+1),
+    tail_index[k] the index of that element, and previous[i] the index of the element before i in the
+    subsequence ending at i (the top of the pile to the left when i was placed), or -1.
 */
-auto longest_increasing_subsequence(vector<int> &sequence) -> vector<int> {
-
-    // Auxillary vector for restoring the solution at the end
-    vector<Previous*> previous(sequence.size());
-    
-    vector<int> piles(sequence.size()+1, numeric_limits<int>::max()); // Each index represents the top element in a pile
-    piles[0] = -numeric_limits<int>::max();
-    for (int i = 0; i < sequence.size(); ++i) {
-
-        /* 
-            Find the index to potentially place the element, which should be the leftmost pile
-            which value is greater than that of the element, which is equivalent to doing an 
-            upper bound search in the piles for sequence[i];
-
-            Subtracting piles.begin() to get the index of the upper bound for sequence[i] piles 
-        */
-        int pile_index = upper_bound(piles.begin(), piles.end(), sequence[i]) - piles.begin(); 
-
-        /* 
-            If element is less than the top of the current pile and greater than the previous pile 
-            We should add it to the current pile
-        */
-        if (piles[pile_index-1] < sequence[i] && sequence[i] < piles[pile_index]) {
-            piles[pile_index] = sequence[i];
-            // Save data for restoring later
-            previous[pile_index] = new Previous();
-            previous[pile_index]->p = previous[pile_index-1];
-            previous[pile_index]->index = i;
-        }
-    }
-
-    // Get the length of the lis
-    int lis = 0;
-    for (int i = 0; i <= sequence.size(); i++) {
-        if (piles[i] < numeric_limits<int>::max())
-            lis = i;
-    }
-
-    // Follow the chain backwards from the last element until we find a null pointer
-    vector<int> indices;
-    Previous *p = previous[lis];
-    while (true) {
-        indices.push_back(p->index);
-        p = p->p;
-        if (p == nullptr) {
-            break;
-        }
-    }
-    reverse(indices.begin(), indices.end());
-    return indices;
+struct LisEngine {
+    vector<int> tails, tail_index, previous;
+
+    // Parallel mode: the level of every element (see LevelTree)
+    vector<int> level;
+
+    // Weighted mode: the sorted distinct values and the fenwick tree of best sums (and their indices) over them
+    vector<int> values;
+    vector<long> best_sum;
+    vector<int> best_index;
+    vector<long> sums;
+
+    template<Order ORDER>
+    auto patience_sort(const vector<int> & sequence) -> int {
+        int n = sequence.size();
+        tails.resize(n);
+        tail_index.resize(n);
+        previous.resize(n);
+        int len = 0;
+        for (int i = 0; i < n; ++i) {
+            int x = sequence[i];
+            int pile_index = pile_search<ORDER>(tails.data(), len, x);
+            /*
+                For increasing subsequences an element equal to the top of its pile changes nothing
+                (and we keep the earlier element on the pile)
+            */
+            if (ORDER == Order::Increasing && pile_index < len && tails[pile_index] == x) {
+                continue;
+            }
+            tails[pile_index] = x;
+            tail_index[pile_index] = i;
+            previous[i] = pile_index > 0 ? tail_index[pile_index - 1] : -1;
+            len = max(len, pile_index + 1);
+        }
+        return len;
+    }
+
+    // Follow the chain backwards from the element with the given index
+    auto chain(int last, int len) -> vector<int> {
+        vector<int> indices(len);
+        for (int k = len - 1; k >= 0; --k) {
+            indices[k] = last;
+            last = previous[last];
+        }
+        return indices;
+    }
+
+    // The indices of a longest increasing (or non-decreasing) subsequence
+    auto longest(const vector<int> & sequence, Order order = Order::Increasing) -> vector<int> {
+        if (lis_threads > 1 && int(sequence.size()) >= PARALLEL_LIS_MIN_SIZE) {
+            return parallel_longest(sequence, order, lis_threads);
+        }
+        int len = order == Order::Increasing ? patience_sort<Order::Increasing>(sequence)
+            : patience_sort<Order::NonDecreasing>(sequence);
+        return len == 0 ? vector<int>() : chain(tail_index[len - 1], len);
+    }
+
+    /*
+        Finds the level (see LevelTree) of every element, level 1 first, with the sequence split into chunks.
+        Round r of chunk c needs the running minimum before the chunk, the minimum of the elements of the
+        chunks before it left after round r-1. Chunk c-1 knows that as soon as it has done its own round r-1
+        and got the running minimum before itself, so it passes it on right away (before its round r).
+        A running minimum of OPEN means the chunks before are empty for good, after it nothing more is sent.
+
+        Which chunks have many elements of a level moves from the first towards the last ones as the levels
+        go up, so with one contiguous chunk per thread most of the threads would be waiting most of the time.
+        Instead there are PIPELINE_CHUNKS_PER_THREAD chunks per thread, handed out in turn (chunk c to thread
+        c % threads), and every thread does a round in all of its chunks before starting the next. The
+        running minimums go from thread t to thread t+1 (and from the last thread back to the first) through
+        pipes[t+1], for every chunk of a round in order. The threads form a pipeline where each is less than
+        a round behind the one before it, and there is no point where all of them wait.
+        Elements found in parallel are counted in levelled_in_parallel.
+
+        If the rounds are given up (see PIPELINE_CHECK_ROUND) the chunks are at different rounds. Every
+        level up to the smallest round completed by a chunk that still had elements is correct, the levels
+        above are cleared and those elements are patience sorted, which gives them their level minus that
+        round. Returns the largest level.
+    */
+    long levelled_in_parallel = 0;
+
+    template<Order ORDER>
+    auto find_levels(const vector<int> & sequence, int threads) -> int {
+        using Tree = LevelTree<ORDER>;
+        int n = sequence.size();
+        level.assign(n, 0);
+        int chunks = threads == 1 ? 1 : threads * PIPELINE_CHUNKS_PER_THREAD;
+        vector<RoundPipe> pipes(threads);
+        vector<int> completed(chunks, 0), highest(chunks, 0);
+        vector<char> finished(chunks, false);
+        atomic<bool> stop(false);
+        atomic<long> found_total(0);
+        run_on_threads(threads, [&](int t) {
+            vector<Tree> trees;
+            vector<char> before_empty;
+            for (int c = t; c < chunks; c += threads) {
+                trees.emplace_back(sequence.data(), level.data(), long(n) * c / chunks, long(n) * (c + 1) / chunks);
+                before_empty.push_back(c == 0);
+            }
+            RoundPipe & in = pipes[t], & out = pipes[(t + 1) % threads];
+            int left = trees.size();
+            bool stopped = false;
+            for (int r = 1; left > 0 && !stopped; ++r) {
+                long round_found = 0;
+                for (int k = 0, c = t; k < (int)trees.size(); ++k, c += threads) {
+                    if (finished[c]) {
+                        continue;
+                    }
+                    long running = Tree::OPEN;
+                    if (!before_empty[k]) {
+                        if (!in.receive(running, stop)) {
+                            stopped = true;
+                            break;
+                        }
+                        before_empty[k] = running == Tree::OPEN;
+                    }
+                    long own = trees[k].minimum();
+                    if (c + 1 < chunks && !out.send(min(running, own), stop)) {
+                        stopped = true;
+                        break;
+                    }
+                    if (before_empty[k] && own == Tree::EMPTY) {
+                        finished[c] = true;
+                        --left;
+                        continue;
+                    }
+                    long found = trees[k].peel(1, running, r);
+                    completed[c] = r;
+                    if (found > 0) {
+                        highest[c] = r;
+                        round_found += found;
+                    }
+                }
+                long total = found_total.fetch_add(round_found, memory_order_relaxed) + round_found;
+                if (r >= PIPELINE_CHECK_ROUND && (r & (r - 1)) == 0 && total < r * PIPELINE_MIN_ROUND_WORK) {
+                    stop.store(true, memory_order_relaxed);
+                }
+                stopped = stopped || stop.load(memory_order_relaxed);
+            }
+        });
+
+        int rounds = *max_element(highest.begin(), highest.end());
+        bool all_finished = true;
+        for (int c = 0; c < chunks; ++c) {
+            if (!finished[c]) {
+                rounds = all_finished ? completed[c] : min(rounds, completed[c]);
+                all_finished = false;
+            }
+        }
+        levelled_in_parallel = n;
+        if (all_finished) {
+            return rounds;
+        }
+
+        tails.resize(n);
+        int len = 0;
+        for (int i = 0; i < n; ++i) {
+            if (level[i] != 0 && level[i] <= rounds) {
+                continue;
+            }
+            --levelled_in_parallel;
+            int x = sequence[i];
+            int pile_index = pile_search<ORDER>(tails.data(), len, x);
+            level[i] = rounds + pile_index + 1;
+            if (ORDER == Order::Increasing && pile_index < len && tails[pile_index] == x) {
+                continue;
+            }
+            tails[pile_index] = x;
+            len = max(len, pile_index + 1);
+        }
+        return rounds + len;
+    }
+
+    /*
+        Same result as longest (up to which of several longest subsequences) using threads threads.
+        The elements of one level are in decreasing (non-increasing for Increasing) order, since a larger
+        one later would have a higher level. So for an element of level r, the last element of level r-1
+        before it is the smallest one before it and is smaller than it (not larger for NonDecreasing) since
+        it has some predecessor of level r-1. A subsequence is then picked from the back in one scan.
+    */
+    auto parallel_longest(const vector<int> & sequence, Order order, int threads) -> vector<int> {
+        int len = order == Order::Increasing ? find_levels<Order::Increasing>(sequence, threads)
+            : find_levels<Order::NonDecreasing>(sequence, threads);
+        vector<int> indices(len);
+        for (int i = int(sequence.size()) - 1, wanted = len; wanted > 0; --i) {
+            if (level[i] == wanted) {
+                indices[--wanted] = i;
+            }
+        }
+        return indices;
+    }
+
+    /*
+        The indices of an increasing (or non-decreasing) subsequence with the largest sum of weights
+        (a non-empty one, so if all weights are negative it's the largest one alone).
+        sums[i], the largest sum of a subsequence ending at i, is weights[i] plus the largest sums[j] of the
+        elements j before i with a smaller (or equal) value, if that is positive. Going from left to right,
+        a fenwick tree indexed by the rank of the value among the distinct values keeps the largest sums of
+        the elements so far for every prefix of the ranks. O(n log n).
+    */
+    auto heaviest(const vector<int> & sequence, const vector<long> & weights,
+        Order order = Order::Increasing) -> vector<int> {
+
+        int n = sequence.size();
+        if (n == 0) {
+            return vector<int>();
+        }
+        values.assign(sequence.begin(), sequence.end());
+        sort(values.begin(), values.end());
+        values.erase(unique(values.begin(), values.end()), values.end());
+        int m = values.size();
+        best_sum.assign(m + 1, numeric_limits<long>::min());
+        best_index.assign(m + 1, -1);
+        sums.resize(n);
+        previous.resize(n);
+
+        int last = 0;
+        for (int i = 0; i < n; ++i) {
+            // 1-based rank of the value, the prefix of ranks to look in excludes it for Increasing
+            int rank = lower_bound(values.begin(), values.end(), sequence[i]) - values.begin() + 1;
+            long before = numeric_limits<long>::min();
+            int before_index = -1;
+            for (int r = order == Order::Increasing ? rank - 1 : rank; r > 0; r -= r & -r) {
+                if (best_sum[r] > before) {
+                    before = best_sum[r];
+                    before_index = best_index[r];
+                }
+            }
+            if (before > 0) {
+                sums[i] = weights[i] + before;
+                previous[i] = before_index;
+            }
+            else {
+                sums[i] = weights[i];
+                previous[i] = -1;
+            }
+            for (int r = rank; r <= m; r += r & -r) {
+                if (sums[i] > best_sum[r]) {
+                    best_sum[r] = sums[i];
+                    best_index[r] = i;
+                }
+            }
+            if (sums[i] > sums[last]) {
+                last = i;
+            }
+        }
+
+        vector<int> indices;
+        for (int i = last; i != -1; i = previous[i]) {
+            indices.push_back(i);
+        }
+        reverse(indices.begin(), indices.end());
+        return indices;
+    }
+};
+
+#ifdef BENCHMARK
+#include <chrono>
+#include <random>
+
+/*
+    Compile with -DBENCHMARK -pthread to time the serial patience sort against parallel_longest with
+    1, 2, 4, ... hardware threads. The subsequences found must be as long as the serial one and increasing.
+    "vs serial" is the serial time divided by the parallel one, so below 1 the parallel path is slower.
+    It is, at about 0.15-0.2 on random sequences with one thread (n = 2^22: 0.47 s serial, 2.6 s peeling)
+    and also with 2 threads (0.39 s against 2.19 s); only set lis_threads on a machine where it shows above 1.
+    "parallel" is the share of the elements whose level was found by the pipeline rather than the serial
+    patience sort it falls back on. The random sequences (lis about 2 sqrt(n)) are done entirely by the
+    pipeline. The nearly sorted ones (a sorted sequence where every element is moved by up to 1000
+    positions, lis about n / 30) have too little work per round and fall back after PIPELINE_CHECK_ROUND rounds.
+*/
+auto benchmark() -> void {
+    mt19937 rng(0);
+    LisEngine engine;
+    int hardware = max(1u, thread::hardware_concurrency());
+    cout << "input\tn\tthreads\ttime (s)\tvs serial\tparallel\tvalid\n";
+    for (bool nearly_sorted : {false, true}) {
+        for (int n : {1 << 20, 1 << 24, 1 << 27}) {
+            vector<int> sequence(n);
+            for (int i = 0; i < n; ++i) {
+                sequence[i] = nearly_sorted ? i + rng() % 1000 : rng();
+            }
+            const char * input = nearly_sorted ? "nearly sorted" : "random";
+            auto start = chrono::steady_clock::now();
+            size_t serial = engine.longest(sequence).size();
+            double serial_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            cout << input << "\t" << n << "\tserial\t" << serial_time << "\t1\t0\tyes\n";
+            for (int threads = 1; threads <= hardware; threads *= 2) {
+                start = chrono::steady_clock::now();
+                vector<int> indices = engine.parallel_longest(sequence, Order::Increasing, threads);
+                double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                bool valid = indices.size() == serial;
+                for (size_t k = 1; k < indices.size(); ++k) {
+                    valid = valid && indices[k - 1] < indices[k] && sequence[indices[k - 1]] < sequence[indices[k]];
+                }
+                cout << input << "\t" << n << "\t" << threads << "\t" << elapsed << "\t" << serial_time / elapsed
+                    << "\t" << double(engine.levelled_in_parallel) / n << "\t" << (valid ? "yes" : "NO") << "\n";
+            }
+        }
+    }
 }
+#endif
 
 auto main () -> int {
+#ifdef BENCHMARK
+    benchmark();
+    return 0;
+#endif
 
+    LisEngine engine;
     int sequence_len;
     while (cin >> sequence_len) {
         vector<int> sequence(sequence_len);
         for (int i = 0; i < sequence_len; ++i) {
             cin >> sequence[i];
         }
-        auto indicies = longest_increasing_subsequence(sequence);
+        auto indicies = engine.longest(sequence);
         cout << indicies.size() << '\n';
         stringstream ss;
         for (auto i : indicies) {
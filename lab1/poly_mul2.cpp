@@ -7,44 +7,366 @@
 #include <sstream>
 #include <cmath>
 #include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <map>
+#include <atomic>
+#include <mutex>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define X86_KERNELS
+#endif
 
 using namespace std;
 
+using cd = complex<double>;
+const double PI = acos(-1);
+
+/*
+    A complex signal stored as a structure of arrays, with the real and imaginary parts in two
+    separate arrays. This way consecutive elements of the signal are consecutive in memory for
+    each part, which is what the vectorized butterflies below need.
+*/
+struct SplitSignal {
+    vector<double> re, im;
+
+    auto assign(int n) -> void {
+        re.assign(n, 0);
+        im.assign(n, 0);
+    }
+
+    auto size() const -> int {
+        return re.size();
+    }
+
+    auto operator[](int i) const -> cd {
+        return cd(re[i], im[i]);
+    }
+
+    auto set(int i, cd x) -> void {
+        re[i] = real(x);
+        im[i] = imag(x);
+    }
+};
+
+/*
+    Everything the fft needs for transforms of a given size, built once and then reused for
+    every multiplication of that size:
+        roots: The roots of unity. For every power of two len the roots exp(2*pi*i*j/len), j < len/2,
+            are stored at index len/2 + j. Each root is computed directly using polar instead of by
+            repeatedly multiplying with exp(2*pi*i/len) since that accumulates rounding errors.
+        reversed: reversed[i] is i with its log2(size) bits reversed.
+    Both tables also work for every smaller power of two n, the roots as they are and the
+    reversed indices shifted right by log2(size/n).
+    A plan is never written after it has been built, so any number of threads can share it.
+*/
+struct FFTPlan {
+    int size;
+    SplitSignal roots;
+    vector<int> reversed;
+
+    FFTPlan(int size) : size(size) {
+        roots.assign(max(size, 2));
+        roots.set(1, 1);
+        for (int half = 2; half < size; half *= 2) {
+            for (int j = 0; j < half; ++j) {
+                roots.set(half + j, polar(1.0, PI * j / half));
+            }
+        }
+
+        reversed = vector<int>(size, 0);
+        for (int i = 1; i < size; ++i) {
+            reversed[i] = (reversed[i / 2] / 2) | (i & 1 ? size / 2 : 0);
+        }
+    }
+};
+
+/*
+    Butterflies for count consecutive pairs (x[j], x[j+half]) of a split signal where w[j] is the
+    twiddle for pair j:
+        x[j] = x[j] + w[j]*x[j+half]
+        x[j+half] = x[j] - w[j]*x[j+half]
+    There is one version per instruction set, processing 1, 4 (AVX2) or 8 (AVX-512) pairs at a time,
+    the widest one the cpu supports is picked when the program starts.
+*/
+using ButterflyKernel = void (*)(double *, double *, const double *, const double *, int, int);
+
+void butterflies_scalar(double * re, double * im, const double * w_re, const double * w_im, int half, int count) {
+    for (int j = 0; j < count; ++j) {
+        double odd_re = re[j + half] * w_re[j] - im[j + half] * w_im[j];
+        double odd_im = re[j + half] * w_im[j] + im[j + half] * w_re[j];
+        re[j + half] = re[j] - odd_re;
+        im[j + half] = im[j] - odd_im;
+        re[j] += odd_re;
+        im[j] += odd_im;
+    }
+}
+
+#ifdef X86_KERNELS
+__attribute__((target("avx2,fma")))
+void butterflies_avx2(double * re, double * im, const double * w_re, const double * w_im, int half, int count) {
+    int j = 0;
+    for (; j + 4 <= count; j += 4) {
+        __m256d wr = _mm256_loadu_pd(w_re + j), wi = _mm256_loadu_pd(w_im + j);
+        __m256d xr = _mm256_loadu_pd(re + j + half), xi = _mm256_loadu_pd(im + j + half);
+        __m256d odd_re = _mm256_fmsub_pd(xr, wr, _mm256_mul_pd(xi, wi));
+        __m256d odd_im = _mm256_fmadd_pd(xr, wi, _mm256_mul_pd(xi, wr));
+        __m256d even_re = _mm256_loadu_pd(re + j), even_im = _mm256_loadu_pd(im + j);
+        _mm256_storeu_pd(re + j + half, _mm256_sub_pd(even_re, odd_re));
+        _mm256_storeu_pd(im + j + half, _mm256_sub_pd(even_im, odd_im));
+        _mm256_storeu_pd(re + j, _mm256_add_pd(even_re, odd_re));
+        _mm256_storeu_pd(im + j, _mm256_add_pd(even_im, odd_im));
+    }
+    butterflies_scalar(re + j, im + j, w_re + j, w_im + j, half, count - j);
+}
+
+__attribute__((target("avx512f")))
+void butterflies_avx512(double * re, double * im, const double * w_re, const double * w_im, int half, int count) {
+    int j = 0;
+    for (; j + 8 <= count; j += 8) {
+        __m512d wr = _mm512_loadu_pd(w_re + j), wi = _mm512_loadu_pd(w_im + j);
+        __m512d xr = _mm512_loadu_pd(re + j + half), xi = _mm512_loadu_pd(im + j + half);
+        __m512d odd_re = _mm512_fmsub_pd(xr, wr, _mm512_mul_pd(xi, wi));
+        __m512d odd_im = _mm512_fmadd_pd(xr, wi, _mm512_mul_pd(xi, wr));
+        __m512d even_re = _mm512_loadu_pd(re + j), even_im = _mm512_loadu_pd(im + j);
+        _mm512_storeu_pd(re + j + half, _mm512_sub_pd(even_re, odd_re));
+        _mm512_storeu_pd(im + j + half, _mm512_sub_pd(even_im, odd_im));
+        _mm512_storeu_pd(re + j, _mm512_add_pd(even_re, odd_re));
+        _mm512_storeu_pd(im + j, _mm512_add_pd(even_im, odd_im));
+    }
+    butterflies_scalar(re + j, im + j, w_re + j, w_im + j, half, count - j);
+}
+#endif
+
+auto select_butterfly_kernel() -> ButterflyKernel {
+#ifdef X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return butterflies_avx512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return butterflies_avx2;
+    }
+#endif
+    return butterflies_scalar;
+}
+
+const ButterflyKernel butterflies = select_butterfly_kernel();
+
+/*
+    Runs f(0) ... f(threads-1), f(0) on the calling thread. transform calls it once per group of stages,
+    so returning (after the joins) is what orders one stage before the next, and multiply_batch calls it
+    once per batch. Starting threads costs some tens of microseconds, which is why only transforms of
+    at least PARALLEL_FFT_MIN_SIZE are split.
+*/
+template<typename F>
+auto run_on_threads(int threads, F f) -> void {
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(f, t);
+    }
+    f(0);
+    for (thread & worker : workers) {
+        worker.join();
+    }
+}
+
+/*
+    Transforms of at least this size are split across fft_threads() threads, which is the number of
+    hardware threads rounded down to a power of two (so that the signal splits evenly).
+    Threads which are already one of several workers (see multiply_batch) set in_worker_thread
+    and keep their transforms to themselves.
+*/
+const int PARALLEL_FFT_MIN_SIZE = 1 << 20;
+thread_local bool in_worker_thread = false;
+
+auto hardware_threads() -> int {
+    return max(1u, thread::hardware_concurrency());
+}
+
+auto fft_threads() -> int {
+    if (in_worker_thread) {
+        return 1;
+    }
+    int threads = 1;
+    while (2 * threads <= hardware_threads()) {
+        threads *= 2;
+    }
+    return threads;
+}
+
+/*
+    Bit reversal permutation of the indices [begin, end) of a signal of size n, where index i is
+    swapped with index reverse_bits(i). Each pair is swapped by whoever owns the smaller index so
+    disjoint ranges can be permuted in parallel.
+*/
+auto bit_reverse(double * re, double * im, const FFTPlan & plan, int n, int begin, int end) -> void {
+    int shift = __builtin_ctz(plan.size / n);
+    for (int i = begin; i < end; ++i) {
+        int j = plan.reversed[i] >> shift;
+        if (i < j) {
+            swap(re[i], re[j]);
+            swap(im[i], im[j]);
+        }
+    }
+}
+
+// All butterfly stages that stay within the block [start, start + len)
+auto block_stages(double * re, double * im, const SplitSignal & roots, int start, int len) -> void {
+    for (int half = 1; half < len; half *= 2) {
+        for (int block = start; block < start + len; block += 2 * half) {
+            butterflies(re + block, im + block, &roots.re[half], &roots.im[half], half, half);
+        }
+    }
+}
+
+/*
+    The forward transform of the signal (re, im) of size n.
+    With T threads the signal is split into T blocks. After the bit reversal every block is an
+    independent sub transform which is done by its own thread. The remaining log(T) stages each have
+    n/2 butterflies which are split evenly between the threads.
+*/
+auto transform(double * re, double * im, int n, const FFTPlan & plan) -> void {
+    const SplitSignal & roots = plan.roots;
+    int threads = n >= PARALLEL_FFT_MIN_SIZE ? fft_threads() : 1;
+    int block_len = n / threads;
+
+    run_on_threads(threads, [&](int t) {
+        bit_reverse(re, im, plan, n, t * block_len, (t + 1) * block_len);
+    });
+    run_on_threads(threads, [&](int t) {
+        block_stages(re, im, roots, t * block_len, block_len);
+    });
+    for (int half = block_len; half < n; half *= 2) {
+        int count = n / 2 / threads;
+        run_on_threads(threads, [&](int t) {
+            // Since half >= count all butterflies of a thread are in the same block
+            int first = t * count;
+            int offset = first / half * 2 * half + first % half;
+            int j = first % half;
+            butterflies(re + offset, im + offset, &roots.re[half + j], &roots.im[half + j], half, count);
+        });
+    }
+}
+
 /*
     fast fourier transforms which computes the discrete fourier transform of a signal
     Runs in O(nlog(n))
 
     The time complexity is gained from splitting the dft into two 
-    smaller dfts recursivly. The summation of the bottom(which runs in O(n)) uses the results of these
-    recursive calls.
-*/
-using cd = complex<double>;
-const double PI = acos(-1);
+    smaller dfts recursivly. Instead of actually recursing (and allocating the even and odd
+    halves at every level) we do it bottom up and in place:
+        1. Reorder the signal so that index i is swapped with index reverse_bits(i). After this
+           every recursive subproblem is a contiguous block of the signal.
+        2. Combine blocks of size half into blocks of size 2*half with the usual butterfly
+           for half = 1, 2, 4 ... n/2.
+    The size of the signal has to be a power of 2 no larger than the size of the plan.
 
-void fft(vector<cd> & signal, bool invert) {
+    The inverse transform uses that swapping the real and imaginary parts of a signal turns the
+    forward transform into the (unscaled) inverse one, which is free with split arrays.
+*/
+void fft(SplitSignal & signal, bool invert, const FFTPlan & plan) {
     int n = signal.size();
     if (n == 1)
         return;
 
-    vector<cd> signal_even(n / 2), signal_odd(n / 2);
-    for (int i = 0; 2 * i < n; i++) {
-        signal_even[i] = signal[2*i];
-        signal_odd[i] = signal[2*i+1];
+    if (!invert) {
+        transform(signal.re.data(), signal.im.data(), n, plan);
+        return;
     }
+    transform(signal.im.data(), signal.re.data(), n, plan);
+    for (int i = 0; i < n; ++i) {
+        signal.re[i] /= n;
+        signal.im[i] /= n;
+    }
+}
+
+/*
+    The plan for transforms of size n. Plans are built once and shared by all threads, so the workers of
+    multiply_batch (which only live for one batch) don't rebuild the tables every time. The lock is only
+    held while looking up (or building) a plan, elements of a map never move once inserted.
+*/
+auto fft_plan(int n) -> const FFTPlan & {
+    static map<int, FFTPlan> plans;
+    static mutex plans_lock;
+    lock_guard<mutex> guard(plans_lock);
+    return plans.try_emplace(n, n).first->second;
+}
 
-    fft(signal_even, invert);
-    fft(signal_odd, invert);
+/*
+    Number theoretic transform, the same algorithm as the fft above but over the integers modulo
+    a prime p = c*2^k + 1 instead of over the complex numbers. For such a prime g^((p-1)/len) is a
+    len:th root of unity modulo p (g being a primitive root) for every power of two len <= 2^k.
+    Since all arithmetic is exact there are no rounding errors.
+*/
+struct NTTPrime {
+    uint32_t mod;
+    uint32_t root; // Primitive root
+    int max_log; // Largest k such that 2^k divides mod-1
+};
+
+const NTTPrime NTT_PRIMES[] = {
+    {998244353, 3, 23},
+    {167772161, 3, 25},
+    {469762049, 3, 26},
+};
+const int NTT_MAX_SIZE = 1 << 23;
+
+auto pow_mod(uint64_t base, uint64_t exp, uint32_t mod) -> uint32_t {
+    uint64_t result = 1;
+    base %= mod;
+    while (exp > 0) {
+        if (exp & 1) {
+            result = result * base % mod;
+        }
+        base = base * base % mod;
+        exp >>= 1;
+    }
+    return result;
+}
 
-    double ang = 2 * PI / n * (invert ? -1 : 1);
-    cd w(1), wn(cos(ang), sin(ang));
-    for (int i = 0; 2 * i < n; i++) {
-        signal[i] = signal_even[i] + w * signal_odd[i];
-        signal[i + n/2] = signal_even[i] - w * signal_odd[i];
+void ntt(vector<uint32_t> & signal, bool invert, const NTTPrime & prime) {
+    int n = signal.size();
+    uint32_t mod = prime.mod;
+
+    for (int i = 1, j = 0; i < n; ++i) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            swap(signal[i], signal[j]);
+        }
+    }
+
+    for (int half = 1; half < n; half *= 2) {
+        uint32_t wlen = pow_mod(prime.root, (mod - 1) / (2 * half), mod);
         if (invert) {
-            signal[i] /= 2;
-            signal[i + n/2] /= 2;
+            wlen = pow_mod(wlen, mod - 2, mod);
+        }
+        for (int start = 0; start < n; start += 2 * half) {
+            uint64_t w = 1;
+            for (int j = 0; j < half; ++j) {
+                uint32_t even = signal[start + j];
+                uint32_t odd = signal[start + j + half] * w % mod;
+                signal[start + j] = even + odd < mod ? even + odd : even + odd - mod;
+                signal[start + j + half] = even >= odd ? even - odd : even + mod - odd;
+                w = w * wlen % mod;
+            }
+        }
+    }
+
+    if (invert) {
+        uint64_t n_inv = pow_mod(n, mod - 2, mod);
+        for (uint32_t & x : signal) {
+            x = x * n_inv % mod;
         }
-        w *= wn;
     }
 }
 
@@ -60,8 +382,11 @@ void fft(vector<cd> & signal, bool invert) {
 
     To do this we need to first perform a discrete fourier transform on each of the vectors
     for which we will use the FFT algorithm.
+
+    The result is rounded to the nearest integer, which is only correct as long as the rounding
+    errors of the fft stay below 0.5 (see fft_is_exact).
 */
-auto multiply(vector<cd> x1, vector<cd> x2) -> vector<cd> {
+auto multiply_fft(const vector<long long> & x1, const vector<long long> & x2) -> vector<long long> {
     int new_degree = (x1.size()-1) + (x2.size()-1);
 
     /*
@@ -73,51 +398,489 @@ auto multiply(vector<cd> x1, vector<cd> x2) -> vector<cd> {
     int new_size = 1;
     while (new_size < x1.size() + x2.size()) 
         new_size *=2;
-    x1.resize(new_size);
-    x2.resize(new_size);
 
-    fft(x1, false);
-    fft(x2, false);
+    const FFTPlan & plan = fft_plan(new_size);
 
-    vector<cd> pairwise_mult;
+    /*
+        Since both signals are real we don't need one complex transform each. Instead
+        we pack them into a single signal z = x1 + i*x2 and use that the transform of a real signal
+        is conjugate symmetric (X[n-k] = conj(X[k])) to separate the two spectra:
+            X1[k] = (Z[k] + conj(Z[n-k])) / 2
+            X2[k] = (Z[k] - conj(Z[n-k])) / 2i
+    */
+    thread_local SplitSignal packed, half_spectrum;
+
+    /*
+        The rounding errors of the packed transform are relative to the norm of z, and separating the
+        spectra hands them to both X1 and X2. If one input is much larger than the other its errors swamp
+        the spectrum of the smaller one. So x2 is first scaled by the power of two which brings its norm
+        closest to that of x1, which makes the error of the product the same as with two transforms of
+        their own (that fft_is_exact bounds). Scaling by a power of two is exact, and so is undoing it.
+    */
+    double norm1 = 0, norm2 = 0;
+    for (long long x : x1) {
+        norm1 += double(x) * double(x);
+    }
+    for (long long x : x2) {
+        norm2 += double(x) * double(x);
+    }
+    int scale_exponent = norm1 > 0 && norm2 > 0 ? int(lround(0.5 * log2(norm1 / norm2))) : 0;
+
+    packed.assign(new_size);
     for (int i = 0; i < x1.size(); ++i) {
-        pairwise_mult.push_back(x1[i]*x2[i]);
+        packed.re[i] = x1[i];
+    }
+    for (int i = 0; i < x2.size(); ++i) {
+        packed.im[i] = ldexp(double(x2[i]), scale_exponent);
+    }
+    fft(packed, false, plan);
+
+    auto pairwise_mult = [&](int k) -> cd {
+        cd z = packed[k];
+        cd z_mirror = conj(packed[(new_size - k) & (new_size - 1)]);
+        return (z + z_mirror) * 0.5 * (z - z_mirror) * cd(0, -0.5);
+    };
+
+    /*
+        The product is real as well, so its inverse transform can be done with a transform of
+        half the size. Packing the even and odd coefficients of the product as y = even + i*odd,
+        the fft of size n is split (as in one step of the fft) into
+            P[k] = E[k] + w^k * O[k],  P[k + n/2] = E[k] - w^k * O[k]
+        which gives us E and O, and thereby Y = E + i*O, from P.
+    */
+    int half = new_size / 2;
+    const SplitSignal & roots = plan.roots;
+    half_spectrum.assign(half);
+    for (int k = 0; k < half; ++k) {
+        cd low = pairwise_mult(k), high = pairwise_mult(k + half);
+        cd even = (low + high) * 0.5;
+        cd odd = (low - high) * 0.5 * conj(roots[half + k]);
+        half_spectrum.set(k, even + cd(0, 1) * odd);
     }
-    fft(pairwise_mult, true);
+    fft(half_spectrum, true, plan);
 
     //Adjust to only return the part of the vector we want a.k.a [x^0 .. x^degree]
-    return vector<cd>(pairwise_mult.begin(), pairwise_mult.begin() + new_degree+1);
+    vector<long long> product(new_degree+1);
+    for (int i = 0; i <= new_degree; ++i) {
+        cd y = half_spectrum[i / 2];
+        product[i] = llround(ldexp(i % 2 == 0 ? real(y) : imag(y), -scale_exponent));
+    }
+    return product;
 }
-        
-auto main() -> int {
 
-    int _; //There is only one test case but we still need to read the 1
-    cin >> _;
+/*
+    Exact multiplication using the ntt. The product is computed modulo three different primes
+    and then combined using the chinese remainder theorem (Garner's algorithm) into a value modulo
+    M = p1*p2*p3 (about 2^86). Negative coefficients are handled by interpreting residues
+    greater than M/2 as negative, so the result is exact as long as every coefficient of the
+    product fits in a long long. The size of the product is limited to NTT_MAX_SIZE.
+*/
+auto multiply_ntt(const vector<long long> & x1, const vector<long long> & x2) -> vector<long long> {
+    int new_degree = (x1.size()-1) + (x2.size()-1);
+    int new_size = 1;
+    while (new_size < x1.size() + x2.size()) 
+        new_size *=2;
+
+    thread_local vector<uint32_t> residues[3], scratch;
+    for (int p = 0; p < 3; ++p) {
+        const NTTPrime & prime = NTT_PRIMES[p];
+        vector<uint32_t> & pairwise_mult = residues[p];
+        pairwise_mult.assign(new_size, 0);
+        scratch.assign(new_size, 0);
+        for (int i = 0; i < x1.size(); ++i) {
+            pairwise_mult[i] = (x1[i] % prime.mod + prime.mod) % prime.mod;
+        }
+        for (int i = 0; i < x2.size(); ++i) {
+            scratch[i] = (x2[i] % prime.mod + prime.mod) % prime.mod;
+        }
+
+        ntt(pairwise_mult, false, prime);
+        ntt(scratch, false, prime);
+        for (int i = 0; i < new_size; ++i) {
+            pairwise_mult[i] = uint64_t(pairwise_mult[i]) * scratch[i] % prime.mod;
+        }
+        ntt(pairwise_mult, true, prime);
+    }
+
+    /*
+        Garner's algorithm: write x = r1 + m1*k1 + m1*m2*k2 where 0 <= k1 < m2 and 0 <= k2 < m3
+        and solve for k1 modulo m2 and k2 modulo m3.
+    */
+    const uint64_t m1 = NTT_PRIMES[0].mod, m2 = NTT_PRIMES[1].mod, m3 = NTT_PRIMES[2].mod;
+    const uint64_t m1_inv_m2 = pow_mod(m1, m2 - 2, m2);
+    const uint64_t m12_inv_m3 = pow_mod(m1 * m2 % m3, m3 - 2, m3);
+    const __int128 m12 = __int128(m1) * m2;
+    const __int128 m123 = m12 * m3;
+
+    vector<long long> product(new_degree+1);
+    for (int i = 0; i <= new_degree; ++i) {
+        uint64_t r1 = residues[0][i], r2 = residues[1][i], r3 = residues[2][i];
+        uint64_t k1 = (r2 + m2 - r1 % m2) % m2 * m1_inv_m2 % m2;
+        uint64_t x12_m3 = (r1 + m1 % m3 * k1) % m3;
+        uint64_t k2 = (r3 + m3 - x12_m3) % m3 * m12_inv_m3 % m3;
+        __int128 x = r1 + __int128(m1) * k1 + m12 * k2;
+        if (x > m123 / 2) {
+            x -= m123;
+        }
+        product[i] = static_cast<long long>(x);
+    }
+    return product;
+}
 
-    int x1_deg;
-    cin >> x1_deg;
-    vector<cd> x1(x1_deg+1);
-    for (int i = 0; i < x1_deg+1; ++i) {
-        cin.clear();
-        cin >> x1[i];
+/*
+    Decide whether the fft is accurate enough to give the exact integer product.
+    The rounding error of a coefficient in the fft product grows roughly like
+    eps * log2(n) * |x1|_2 * |x2|_2 where eps is the machine epsilon of a double.
+    We bound the norms using the largest coefficient magnitude and keep a wide margin
+    to the 0.5 at which rounding would go wrong.
+*/
+auto fft_is_exact(const vector<long long> & x1, const vector<long long> & x2) -> bool {
+    double max1 = 0, max2 = 0;
+    for (long long x : x1) {
+        max1 = max(max1, fabs(double(x)));
     }
+    for (long long x : x2) {
+        max2 = max(max2, fabs(double(x)));
+    }
+    double size = x1.size() + x2.size();
+    double error = numeric_limits<double>::epsilon() * log2(size) 
+        * max1 * sqrt(double(x1.size())) * max2 * sqrt(double(x2.size()));
+    return error < 0.01;
+}
 
-    int x2_deg;
-    cin >> x2_deg;
-    vector<cd> x2(x2_deg+1);
-    for (int i = 0; i < x2_deg+1; ++i) {
-        cin.clear();
-        cin >> x2[i];
+/*
+    For small polynomials the fft is slower than the O(n^2) schoolbook multiplication, both because of
+    the constant factor and because the inputs are padded to a power of two. In between the two
+    Karatsuba's O(n^1.58) algorithm is the fastest. The thresholds are the largest size (of the smaller
+    polynomial) for which each method is used, and can be tuned with calibrate_thresholds.
+*/
+int SCHOOLBOOK_THRESHOLD = 32;
+int KARATSUBA_THRESHOLD = 64;
+
+// Writes the n1+n2-1 coefficients of a*b to out
+void schoolbook(const long long * a, int n1, const long long * b, int n2, long long * out) {
+    fill(out, out + n1 + n2 - 1, 0);
+    for (int i = 0; i < n1; ++i) {
+        // Adding a row at a time keeps the inner loop contiguous (and vectorizable)
+        long long a_i = a[i];
+        long long * row = out + i;
+        for (int j = 0; j < n2; ++j) {
+            row[j] += a_i * b[j];
+        }
     }
+}
 
-    vector<cd> product = multiply(x1, x2);
+/*
+    Karatsuba multiplication of a and b which both have n coefficients, the 2n-1 coefficients of the
+    product are written to out. Splitting a = a_lo + x^m * a_hi (and b likewise) we have
+        a*b = z0 + x^m * z1 + x^2m * z2
+    where z0 = a_lo*b_lo, z2 = a_hi*b_hi and z1 = (a_lo+a_hi)*(b_lo+b_hi) - z0 - z2,
+    so three recursive multiplications of half the size are enough.
+    z0 and z2 are written directly to their (non overlapping) places in out while z1 and the sums use
+    scratch, which needs room for about 4n values.
+*/
+void karatsuba(const long long * a, const long long * b, int n, long long * out, long long * scratch) {
+    if (n <= max(SCHOOLBOOK_THRESHOLD, 1)) {
+        schoolbook(a, n, b, n, out);
+        return;
+    }
+    int m = n / 2, k = n - m; // The high half has k >= m coefficients
+
+    karatsuba(a, b, m, out, scratch);
+    out[2*m - 1] = 0;
+    karatsuba(a + m, b + m, k, out + 2*m, scratch);
+
+    long long * a_sum = scratch;
+    long long * b_sum = scratch + k;
+    long long * z1 = scratch + 2*k;
+    for (int i = 0; i < k; ++i) {
+        a_sum[i] = a[m + i] + (i < m ? a[i] : 0);
+        b_sum[i] = b[m + i] + (i < m ? b[i] : 0);
+    }
+    karatsuba(a_sum, b_sum, k, z1, scratch + 4*k - 1);
+
+    for (int i = 0; i < 2*m - 1; ++i) {
+        z1[i] -= out[i];
+    }
+    for (int i = 0; i < 2*k - 1; ++i) {
+        z1[i] -= out[2*m + i];
+    }
+    for (int i = 0; i < 2*k - 1; ++i) {
+        out[m + i] += z1[i];
+    }
+}
+
+/*
+    Karatsuba needs both polynomials to be of the same size, so the larger one is cut into blocks
+    of the same size as the smaller one, the product of each block is then added at its offset.
+*/
+auto multiply_karatsuba(const vector<long long> & x1, const vector<long long> & x2) -> vector<long long> {
+    const vector<long long> & small = x1.size() <= x2.size() ? x1 : x2;
+    const vector<long long> & large = x1.size() <= x2.size() ? x2 : x1;
+    int n = small.size();
+
+    thread_local vector<long long> block, block_product, scratch;
+    block.resize(n);
+    block_product.resize(2*n - 1);
+    scratch.resize(4*n + 128);
+
+    vector<long long> product(x1.size() + x2.size() - 1, 0);
+    for (int start = 0; start < large.size(); start += n) {
+        int len = min<int>(n, large.size() - start);
+        copy(large.begin() + start, large.begin() + start + len, block.begin());
+        fill(block.begin() + len, block.end(), 0);
+
+        karatsuba(block.data(), small.data(), n, block_product.data(), scratch.data());
+        int end = min<int>(2*n - 1, product.size() - start);
+        for (int i = 0; i < end; ++i) {
+            product[start + i] += block_product[i];
+        }
+    }
+    return product;
+}
+
+auto multiply_schoolbook(const vector<long long> & x1, const vector<long long> & x2) -> vector<long long> {
+    vector<long long> product(x1.size() + x2.size() - 1);
+    schoolbook(x1.data(), x1.size(), x2.data(), x2.size(), product.data());
+    return product;
+}
+
+enum class Engine { Auto, Schoolbook, Karatsuba, FFT, NTT };
+
+/*
+    Multiply two integer polynomials. Engine::Auto picks the method based on the size of the
+    smaller polynomial (see SCHOOLBOOK_THRESHOLD and KARATSUBA_THRESHOLD). For large polynomials
+    it uses the (faster) fft whenever fft_is_exact says it's safe and the exact ntt otherwise.
+*/
+auto multiply(const vector<long long> & x1, const vector<long long> & x2, Engine engine = Engine::Auto) -> vector<long long> {
+    if (engine == Engine::Auto) {
+        int smaller_size = min(x1.size(), x2.size());
+        bool ntt_fits = x1.size() + x2.size() <= NTT_MAX_SIZE;
+        if (smaller_size <= SCHOOLBOOK_THRESHOLD) {
+            engine = Engine::Schoolbook;
+        }
+        else if (smaller_size <= KARATSUBA_THRESHOLD) {
+            engine = Engine::Karatsuba;
+        }
+        else {
+            engine = fft_is_exact(x1, x2) || !ntt_fits ? Engine::FFT : Engine::NTT;
+        }
+    }
+    switch (engine) {
+        case Engine::Schoolbook: return multiply_schoolbook(x1, x2);
+        case Engine::Karatsuba: return multiply_karatsuba(x1, x2);
+        case Engine::NTT: return multiply_ntt(x1, x2);
+        default: return multiply_fft(x1, x2);
+    }
+}
+
+/*
+    Multiply many independent pairs of polynomials. The pairs are handed out one at a time to
+    hardware_threads() workers, which all use the same shared plans (see fft_plan) and each their
+    own scratch buffers, so every pair after the first of a given size only pays for the transforms.
+*/
+auto multiply_batch(const vector<pair<vector<long long>, vector<long long>>> & pairs) -> vector<vector<long long>> {
+    vector<vector<long long>> products(pairs.size());
+    int threads = max(1, min<int>(hardware_threads(), pairs.size()));
+    atomic<int> next_pair(0);
+    run_on_threads(threads, [&](int) {
+        in_worker_thread = threads > 1;
+        for (int i = next_pair++; i < pairs.size(); i = next_pair++) {
+            products[i] = multiply(pairs[i].first, pairs[i].second);
+        }
+        in_worker_thread = false;
+    });
+    return products;
+}
+
+/*
+    Multiply a list of polynomials using a balanced product tree: first the polynomials are
+    multiplied pairwise, then those products pairwise and so on. Unlike multiplying them one at a time
+    from the left, both factors of every multiplication are of similar size, and all multiplications
+    on a level of the tree are independent so they are done as one batch.
+*/
+auto multiply_all(vector<vector<long long>> polynomials) -> vector<long long> {
+    if (polynomials.empty()) {
+        return {1};
+    }
+    while (polynomials.size() > 1) {
+        vector<pair<vector<long long>, vector<long long>>> pairs;
+        for (int i = 0; i + 1 < polynomials.size(); i += 2) {
+            pairs.emplace_back(move(polynomials[i]), move(polynomials[i+1]));
+        }
+        vector<vector<long long>> products = multiply_batch(pairs);
+        if (polynomials.size() % 2 == 1) {
+            products.push_back(move(polynomials.back()));
+        }
+        polynomials = move(products);
+    }
+    return polynomials[0];
+}
+
+// Average time in seconds of calling f, repeated until at least 20ms has passed
+template<typename F>
+auto time_per_call(F f) -> double {
+    auto start = chrono::steady_clock::now();
+    int calls = 0;
+    double elapsed = 0;
+    while (elapsed < 0.02) {
+        f();
+        ++calls;
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    return elapsed / calls;
+}
+
+auto random_polynomial(int len, mt19937 & rng) -> vector<long long> {
+    vector<long long> polynomial(len);
+    for (long long & x : polynomial) {
+        x = int(rng() % 2001) - 1000;
+    }
+    return polynomial;
+}
+
+/*
+    Set the thresholds to the crossover points measured on this machine:
+        SCHOOLBOOK_THRESHOLD is set from the first size where one level of karatsuba
+        (on top of schoolbook) beats plain schoolbook.
+        KARATSUBA_THRESHOLD is set from the first size where the fft beats karatsuba.
+*/
+auto calibrate_thresholds() -> void {
+    mt19937 rng(0);
+
+    int n = 4;
+    for (; n <= 4096; n *= 2) {
+        auto x1 = random_polynomial(n, rng), x2 = random_polynomial(n, rng);
+        double schoolbook_time = time_per_call([&] { multiply(x1, x2, Engine::Schoolbook); });
+        SCHOOLBOOK_THRESHOLD = n / 2;
+        double karatsuba_time = time_per_call([&] { multiply(x1, x2, Engine::Karatsuba); });
+        if (karatsuba_time < schoolbook_time) {
+            break;
+        }
+    }
+    SCHOOLBOOK_THRESHOLD = n / 2;
+
+    for (n = 2 * SCHOOLBOOK_THRESHOLD; n <= 1 << 16; n *= 2) {
+        auto x1 = random_polynomial(n, rng), x2 = random_polynomial(n, rng);
+        double karatsuba_time = time_per_call([&] { multiply(x1, x2, Engine::Karatsuba); });
+        double fft_time = time_per_call([&] { multiply(x1, x2, Engine::FFT); });
+        if (fft_time < karatsuba_time) {
+            break;
+        }
+    }
+    KARATSUBA_THRESHOLD = n / 2;
+}
+
+#ifdef BENCHMARK
+// Compile with -DBENCHMARK to calibrate the thresholds and print the time of every method
+auto benchmark() -> void {
+    calibrate_thresholds();
+    cout << "SCHOOLBOOK_THRESHOLD = " << SCHOOLBOOK_THRESHOLD << "\n";
+    cout << "KARATSUBA_THRESHOLD = " << KARATSUBA_THRESHOLD << "\n";
+
+    mt19937 rng(1);
+    cout << "size\tschoolbook\tkaratsuba\tfft\tntt (microseconds)\n";
+    for (int n = 4; n <= 1 << 14; n *= 2) {
+        auto x1 = random_polynomial(n, rng), x2 = random_polynomial(n, rng);
+        cout << n;
+        for (Engine engine : {Engine::Schoolbook, Engine::Karatsuba, Engine::FFT, Engine::NTT}) {
+            cout << "\t" << 1e6 * time_per_call([&] { multiply(x1, x2, engine); });
+        }
+        cout << "\n";
+    }
+}
+#endif
+
+#ifdef SELF_TEST
+/*
+    Compile with -DSELF_TEST to compare multiply (Engine::Auto) with the exact ntt on random pairs whose
+    largest coefficients differ by up to nine orders of magnitude, which the packed fft once got wrong.
+    Returns whether all products agreed.
+*/
+auto self_test() -> bool {
+    mt19937 rng(2);
+    int failures = 0;
+    for (int pair = 0; pair < 200; ++pair) {
+        int n1 = 65 + rng() % 2000, n2 = 65 + rng() % 2000;
+        long long max1 = 1 + rng() % 1000000000, max2 = 1 + rng() % 4;
+        vector<long long> x1(n1), x2(n2);
+        for (long long & x : x1) {
+            x = (long long)(rng() % (2 * max1 + 1)) - max1;
+        }
+        for (long long & x : x2) {
+            x = (long long)(rng() % (2 * max2 + 1)) - max2;
+        }
+        if (pair % 2 == 1) {
+            swap(x1, x2);
+        }
+        if (multiply(x1, x2) != multiply(x1, x2, Engine::NTT)) {
+            cout << "wrong product of sizes " << n1 << " and " << n2 << " with largest coefficients "
+                << max1 << " and " << max2 << "\n";
+            ++failures;
+        }
+    }
+
+    // Product trees of one large factor and three small ones, against multiplying them in order
+    for (int tree = 0; tree < 20; ++tree) {
+        vector<vector<long long>> factors(4);
+        vector<long long> expected = {1};
+        for (int factor = 0; factor < 4; ++factor) {
+            long long largest = factor == tree % 4 ? 100000000 : 3;
+            factors[factor].resize(65 + rng() % 500);
+            for (long long & x : factors[factor]) {
+                x = (long long)(rng() % (2 * largest + 1)) - largest;
+            }
+            expected = multiply(expected, factors[factor], Engine::NTT);
+        }
+        if (multiply_all(factors) != expected) {
+            cout << "wrong product tree " << tree << "\n";
+            ++failures;
+        }
+    }
+    cout << (failures == 0 ? "all products exact" : "FAILED") << "\n";
+    return failures == 0;
+}
+#endif
+
+auto main() -> int {
+#ifdef BENCHMARK
+    benchmark();
+    return 0;
+#endif
+#ifdef SELF_TEST
+    return self_test() ? 0 : 1;
+#endif
+
+    int nr_of_cases; // The problem only has one test case but we might as well handle several
+    cin >> nr_of_cases;
+
+    vector<pair<vector<long long>, vector<long long>>> pairs(nr_of_cases);
+    for (auto & [x1, x2] : pairs) {
+        int x1_deg;
+        cin >> x1_deg;
+        x1.resize(x1_deg+1);
+        for (int i = 0; i < x1_deg+1; ++i) {
+            cin >> x1[i];
+        }
+
+        int x2_deg;
+        cin >> x2_deg;
+        x2.resize(x2_deg+1);
+        for (int i = 0; i < x2_deg+1; ++i) {
+            cin >> x2[i];
+        }
+    }
+
+    vector<vector<long long>> products = multiply_batch(pairs);
 
     stringstream answer;
-    answer << product.size()-1 << "\n";
-    for (auto term : product) {
-        answer << static_cast<int>(round(real(term))) << " ";
+    for (auto & product : products) {
+        answer << product.size()-1 << "\n";
+        for (auto term : product) {
+            answer << term << " ";
+        }
+        answer << "\n";
     }
-    answer << "\n";
     //ofstream file("cpp_result.txt");
     cout << answer.str();
     return 0;
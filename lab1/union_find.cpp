@@ -4,40 +4,159 @@
 #include <iostream>
 #include <vector>
 #include <strstream>
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <algorithm>
+#include <map>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
+/*
+    Array of len elements backed by a memory mapping instead of the heap, used as storage for
+    really large disjoint sets.
+    Without a path the mapping is anonymous, made with MAP_NORESERVE so no swap is set aside for it and
+    pages only become memory when first touched, and asks for transparent huge pages, which cuts the tlb
+    misses of random accesses. (A BasicDisjointSet touches every page right away when it puts each element
+    in its own set, so that only saves the swap reservation, not memory.)
+    With a path the array lives in that file (created/resized as needed) so the operating system can
+    page it out to disk, which allows sets larger than the memory. The constructor taking only a path
+    reopens such a file as it is, with len given by its size.
+    If the file or the mapping can't be made, data is null (check mapped()) and errno tells why.
+*/
+template<typename T>
+struct MappedArray {
+    T * data = nullptr;
+    size_t len = 0;
+
+    MappedArray(size_t len, const char * path = nullptr) : len(len) {
+        int fd = -1;
+        if (path != nullptr) {
+            fd = open(path, O_RDWR | O_CREAT, 0644);
+            if (fd < 0) {
+                return;
+            }
+            if (ftruncate(fd, bytes()) != 0) {
+                close_keeping_errno(fd);
+                return;
+            }
+        }
+        map(path != nullptr ? MAP_SHARED : MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, fd);
+    }
+
+    explicit MappedArray(const char * path) {
+        int fd = open(path, O_RDWR);
+        if (fd < 0) {
+            return;
+        }
+        struct stat file;
+        if (fstat(fd, &file) != 0) {
+            close_keeping_errno(fd);
+            return;
+        }
+        len = file.st_size / sizeof(T);
+        map(MAP_SHARED, fd);
+    }
+
+    auto bytes() const -> size_t {
+        return max<size_t>(len * sizeof(T), 1);
+    }
+
+    auto mapped() const -> bool {
+        return data != nullptr;
+    }
+
+    static auto close_keeping_errno(int fd) -> void {
+        int error = errno;
+        close(fd);
+        errno = error;
+    }
+
+    auto map(int flags, int fd) -> void {
+        void * mapping = mmap(nullptr, bytes(), PROT_READ | PROT_WRITE, flags, fd, 0);
+        if (fd >= 0) {
+            close_keeping_errno(fd); // The mapping keeps the file open
+        }
+        if (mapping == MAP_FAILED) {
+            return;
+        }
+#ifdef MADV_HUGEPAGE
+        madvise(mapping, bytes(), MADV_HUGEPAGE);
+#endif
+        data = static_cast<T *>(mapping);
+    }
+
+    MappedArray(const MappedArray &) = delete;
+    auto operator=(const MappedArray &) -> MappedArray & = delete;
+
+    ~MappedArray() {
+        if (data != nullptr) {
+            munmap(data, bytes());
+        }
+    }
+
+    auto operator[](size_t i) -> T & {
+        return data[i];
+    }
+    auto operator[](size_t i) const -> const T & {
+        return data[i];
+    }
+};
+
 /*
     Simple implementation of the Disjoint-set data structure (aka Union-find) 
     which stores a collection of disjoint sets containing in this case integers.
     The Disjoint-set has two main operations: 
         1. unify(a, b) - merge the subset containing a and the subset containing b into one
         2. find(a) - find the root of the set which contains a 
-    Both run in O(log(n)) (space complexity of O(n)) without path compression and rank
-    With rank and path compression they run with amortized constant time complexity.
+    Both run in O(log(n)) (space complexity of O(n)) without path compression and union by size
+    With union by size and path compression they run with amortized constant time complexity.
+
+    Everything is stored in a single array links: for an element that isn't a root links[n] is its parent,
+    and for a root it is minus the size of its set. That halves the memory compared to separate parent and
+    rank arrays and means that each step of find only touches one array.
+    Index is the integer type of the elements (a signed type, int64_t for sets of more than 2^31 elements)
+    and Storage what holds the array, a vector or a MappedArray.
 */
-struct DisjointSet {
-    vector<int> parents;
-    vector<int> ranks;
+template<typename Index, typename Storage>
+struct BasicDisjointSet {
+    Storage links;
 
-    DisjointSet(int len) {
-        parents = vector<int>(len);
-        ranks = vector<int>(len);
+    // Initially every element has it's own set of size 1
+    BasicDisjointSet(Index len) : links(len) {
+        init(len);
+    }
 
-        // Initially every element has it's own set and is therefore it's own parent
-        for (int i = 0; i < len; ++i) {
-            parents[i] = i;
+    // Only for MappedArray storage, keep the array in the file at path (check links.mapped())
+    BasicDisjointSet(Index len, const char * path) : links(len, path) {
+        if (links.mapped()) {
+            init(len);
         }
     }
 
-    auto find(int n) -> int {
+    // Only for MappedArray storage, reopen the sets kept in the file at path as they were left
+    explicit BasicDisjointSet(const char * path) : links(path) {
+    }
+
+    auto init(Index len) -> void {
+        for (Index i = 0; i < len; ++i) {
+            links[i] = -1;
+        }
+    }
+
+    auto find(Index n) -> Index {
         /*
             Iterate through parents until we find the root of the set
-            which will be the node which is its own parent
+            which will be the node which holds a (negative) size
         */
-       int root = n;
-        while (root != parents[root])
-            root = parents[root];
+       Index root = n;
+        while (links[root] >= 0)
+            root = links[root];
 
 
         /*
@@ -47,17 +166,17 @@ struct DisjointSet {
             This flattens/compresses the tree which grants amortized constant time complexity.
         */
         while (n != root) {
-            int temp = parents[n];
-            parents[n] = root;
+            Index temp = links[n];
+            links[n] = root;
             n = temp;
         }
 
         return n;
     }
 
-    auto unify(int u, int v) -> void {
-        int root_u = find(u);
-        int root_v = find(v);
+    auto unify(Index u, Index v) -> void {
+        Index root_u = find(u);
+        Index root_v = find(v);
 
         // If a and b are already in the same set we do't have to do anything
         if (root_u == root_v) {
@@ -65,47 +184,487 @@ struct DisjointSet {
         }
 
         /*
-            Use ranks to ensure that the smaller set(tree) will be attached to the root of the larger one.
+            Use sizes to ensure that the smaller set(tree) will be attached to the root of the larger one.
             This prevents the tree from becoming overly imbalanced.
+            (The sizes are stored negated so the larger set has the smaller value)
         */
-        if (ranks[root_u] < ranks[root_v]) {
-            parents[root_u] = root_v;
+        if (links[root_u] > links[root_v]) {
+            swap(root_u, root_v);
+        }
+        links[root_u] += links[root_v];
+        links[root_v] = root_u;
+    }
+
+    auto set_size(Index n) -> Index {
+        return -links[find(n)];
+    }
+};
+
+using DisjointSet = BasicDisjointSet<int, vector<int>>;
+// For forests of billions of elements
+using HugeDisjointSet = BasicDisjointSet<int64_t, MappedArray<int64_t>>;
+
+/*
+    Variant of DisjointSet where unions can be undone.
+    Path compression changes the parents of many nodes in every find, which would all have to be recorded
+    to be undone, so this version only uses union by rank. That still keeps the trees at depth O(log(n)),
+    so find runs in O(log(n)), and every union changes at most one parent and one rank.
+    Each union that merged two sets is pushed onto history, snapshot() returns the current size of history and
+    restore(snapshot) undoes all unions made since then, in reverse order.
+*/
+struct RollbackDisjointSet {
+    vector<int> parents;
+    vector<int> ranks;
+
+    struct Change {
+        int attached_root; // Root that got a parent
+        bool rank_increased; // Whether the rank of its new parent was increased
+    };
+    vector<Change> history;
+
+    RollbackDisjointSet(int len) {
+        parents = vector<int>(len);
+        ranks = vector<int>(len);
+        for (int i = 0; i < len; ++i) {
+            parents[i] = i;
         }
-        else if (ranks[root_u] > ranks[root_v]) {
-            parents[root_v] = root_u;
+    }
+
+    auto find(int n) -> int {
+        while (n != parents[n]) {
+            n = parents[n];
+        }
+        return n;
+    }
+
+    // Returns whether u and v were in different sets
+    auto unify(int u, int v) -> bool {
+        int root_u = find(u);
+        int root_v = find(v);
+        if (root_u == root_v) {
+            return false;
+        }
+        if (ranks[root_u] > ranks[root_v]) {
+            swap(root_u, root_v);
+        }
+        // root_u has the lower (or same) rank and is attached below root_v
+        parents[root_u] = root_v;
+        bool rank_increased = ranks[root_u] == ranks[root_v];
+        if (rank_increased) {
+            ranks[root_v]++;
+        }
+        history.push_back({root_u, rank_increased});
+        return true;
+    }
+
+    auto snapshot() -> int {
+        return history.size();
+    }
+
+    auto restore(int snapshot) -> void {
+        while (history.size() > snapshot) {
+            Change change = history.back();
+            history.pop_back();
+            int parent = parents[change.attached_root];
+            if (change.rank_increased) {
+                ranks[parent]--;
+            }
+            parents[change.attached_root] = change.attached_root;
+        }
+    }
+};
+
+// One operation on a graph whose edges can be removed: "+ u v" adds an edge, "- u v" removes one and "? u v" asks
+struct GraphOperation {
+    char op;
+    int u, v;
+};
+
+/*
+    Offline dynamic connectivity, answers every "? u v" (in order) with whether u and v are connected by the edges
+    present at that point.
+
+    Algorithm: Every edge is present during an interval of time (operation indexes), from the operation after
+    it is added until the one removing it (or the end). Build a segment tree over time and store each edge in the
+    O(log(q)) nodes whose ranges make up its interval. A depth first traversal of the tree then adds the edges
+    of a node to a RollbackDisjointSet when entering it and undoes them when leaving. When reaching the leaf of
+    time t exactly the edges present at t have been added, so a query is answered with two finds.
+    Every edge is added O(log(q)) times at O(log(n)) each, so it runs in O((n + q*log(q)) * log(n))
+    instead of rebuilding the components for every query.
+*/
+struct DynamicConnectivity {
+    int q;
+    vector<GraphOperation> operations;
+    vector<vector<pair<int, int>>> segment_edges; // Edges of each node, children of node i are 2i and 2i+1
+    RollbackDisjointSet ds;
+    vector<bool> answers;
+
+    DynamicConnectivity(int nr_of_elements, const vector<GraphOperation> & operations)
+        : q(operations.size()), operations(operations), segment_edges(4 * max(q, 1)), ds(nr_of_elements) {}
+
+    // Store the edge in the nodes covering [l, r), the current node covers [node_l, node_r)
+    auto add_interval(int node, int node_l, int node_r, int l, int r, pair<int, int> edge) -> void {
+        if (r <= node_l || node_r <= l) {
+            return;
+        }
+        if (l <= node_l && node_r <= r) {
+            segment_edges[node].push_back(edge);
+            return;
+        }
+        int mid = (node_l + node_r) / 2;
+        add_interval(2 * node, node_l, mid, l, r, edge);
+        add_interval(2 * node + 1, mid, node_r, l, r, edge);
+    }
+
+    auto traverse(int node, int node_l, int node_r) -> void {
+        int snapshot = ds.snapshot();
+        for (auto [u, v] : segment_edges[node]) {
+            ds.unify(u, v);
+        }
+        if (node_r - node_l == 1) {
+            auto [op, u, v] = operations[node_l];
+            if (op == '?') {
+                answers.push_back(ds.find(u) == ds.find(v));
+            }
         }
         else {
-            parents[root_v] = root_u;
-            ranks[root_u]++;
+            int mid = (node_l + node_r) / 2;
+            traverse(2 * node, node_l, mid);
+            traverse(2 * node + 1, mid, node_r);
+        }
+        ds.restore(snapshot);
+    }
+
+    auto solve() -> vector<bool> {
+        if (q == 0) {
+            return {};
+        }
+        // The times at which each currently present edge was added, edges are stored as (min, max)
+        map<pair<int, int>, vector<int>> added_at;
+        for (int t = 0; t < q; ++t) {
+            auto [op, u, v] = operations[t];
+            pair<int, int> edge = {min(u, v), max(u, v)};
+            if (op == '+') {
+                added_at[edge].push_back(t);
+            }
+            else if (op == '-') {
+                auto it = added_at.find(edge);
+                if (it == added_at.end() || it->second.empty()) {
+                    continue; // Removing an edge that isn't there does nothing
+                }
+                add_interval(1, 0, q, it->second.back() + 1, t, edge);
+                it->second.pop_back();
+            }
+        }
+        for (auto & [edge, times] : added_at) {
+            for (int t : times) {
+                add_interval(1, 0, q, t + 1, q, edge);
+            }
+        }
+
+        answers.clear();
+        traverse(1, 0, q);
+        return answers;
+    }
+};
+
+auto dynamic_connectivity(int nr_of_elements, const vector<GraphOperation> & operations) -> vector<bool> {
+    return DynamicConnectivity(nr_of_elements, operations).solve();
+}
+
+/*
+    Thread safe version of DisjointSet where any number of threads can call unify and find at the same time
+    without taking any locks.
+
+    Instead of ranks (which can't be updated together with the parent atomically) the roots are
+    linked by a fixed priority: the root with the lower priority is attached to the one with the higher.
+    Since parents always have a higher priority than their children the parent pointers can never
+    form a cycle, no matter how the threads interleave. The priority of an element is a pseudo random
+    bijective hash of its index, which gives the same expected O(log(n)) depth as linking randomly
+    (linking by index would degenerate into long chains for edges given in sorted order).
+
+    Linking is done with a compare and swap on the parent of the lower priority root, which fails
+    (and is retried) if another thread linked that root first.
+    find uses path halving, where every other node on the path is pointed to its grandparent.
+    Those updates are also compare and swaps, but failing just means that some other thread already
+    shortened the path so they are not retried. Since they only ever point a node further up the same tree
+    they never change which set a node belongs to.
+*/
+struct ConcurrentDisjointSet {
+    vector<atomic<int>> parents;
+
+    ConcurrentDisjointSet(int len) : parents(len) {
+        for (int i = 0; i < len; ++i) {
+            parents[i].store(i);
+        }
+    }
+
+    static auto priority(int n) -> uint32_t {
+        uint32_t x = n;
+        x = (x ^ (x >> 16)) * 0x45d9f3b;
+        x = (x ^ (x >> 16)) * 0x45d9f3b;
+        return x ^ (x >> 16);
+    }
+
+    auto find(int n) -> int {
+        while (true) {
+            int parent = parents[n].load();
+            if (parent == n) {
+                return n;
+            }
+            int grandparent = parents[parent].load();
+            if (parent != grandparent) {
+                parents[n].compare_exchange_weak(parent, grandparent);
+            }
+            n = grandparent;
+        }
+    }
+
+    auto unify(int u, int v) -> void {
+        while (true) {
+            int root_u = find(u);
+            int root_v = find(v);
+            if (root_u == root_v) {
+                return;
+            }
+            if (priority(root_u) > priority(root_v)) {
+                swap(root_u, root_v);
+            }
+            // Only succeeds if root_u is still a root
+            int expected = root_u;
+            if (parents[root_u].compare_exchange_strong(expected, root_v)) {
+                return;
+            }
+        }
+    }
+
+    /*
+        Whether u and v are in the same set. Comparing find(u) and find(v) is not enough since
+        the root of u could be linked below another root between the two calls, so if the roots differ
+        we check that the root of u is still a root, and otherwise try again.
+    */
+    auto same_set(int u, int v) -> bool {
+        while (true) {
+            int root_u = find(u);
+            int root_v = find(v);
+            if (root_u == root_v) {
+                return true;
+            }
+            if (parents[root_u].load() == root_u) {
+                return false;
+            }
         }
     }
 };
 
+/*
+    Runs f(0) ... f(threads-1) (f(0) on the calling thread). Every phase of connected_components is one
+    call, and the joins at the end are all the synchronization there is between the phases.
+*/
+template<typename F>
+auto run_on_threads(int threads, F f) -> void {
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(f, t);
+    }
+    f(0);
+    for (thread & worker : workers) {
+        worker.join();
+    }
+}
+
+/*
+    Offline connected components for when all edges are known before any queries.
+    Returns an array where element i holds the id of its component (the index of its root),
+    so two elements are in the same set exactly when their ids are equal.
+
+    1. The edge list is split into one chunk per thread and every thread unifies its chunk in
+       its own DisjointSet, so no synchronization is needed. The forest only has the elements the chunk
+       touches (renumbered by their rank among them), so all forests together are O(edges) and not
+       O(threads * elements). Each forest is then reduced to one edge from every non-root to its root,
+       a spanning forest of the chunk which drops all the edges that closed cycles.
+    2. The spanning forests are merged by unifying their edges in one shared ConcurrentDisjointSet,
+       each thread its own.
+    3. The merged forest is flattened, every element gets the root it leads to. The unions are done
+       so this only shortens paths, and the elements are split between the threads.
+*/
+auto connected_components(int nr_of_elements, const vector<pair<int, int>> & edges,
+    int threads = max(1u, thread::hardware_concurrency())) -> vector<int> {
+
+    vector<vector<pair<int, int>>> spanning_forests(threads);
+    long chunk = (edges.size() + threads - 1) / threads;
+    run_on_threads(threads, [&](int t) {
+        long begin = min<long>(t * chunk, edges.size()), end = min<long>(begin + chunk, edges.size());
+        vector<int> elements;
+        elements.reserve(2 * (end - begin));
+        for (long i = begin; i < end; ++i) {
+            elements.push_back(edges[i].first);
+            elements.push_back(edges[i].second);
+        }
+        sort(elements.begin(), elements.end());
+        elements.erase(unique(elements.begin(), elements.end()), elements.end());
+        auto local = [&](int element) -> int {
+            return lower_bound(elements.begin(), elements.end(), element) - elements.begin();
+        };
+
+        DisjointSet forest(elements.size());
+        for (long i = begin; i < end; ++i) {
+            forest.unify(local(edges[i].first), local(edges[i].second));
+        }
+        for (int i = 0; i < elements.size(); ++i) {
+            int root = forest.find(i);
+            if (root != i) {
+                spanning_forests[t].emplace_back(elements[i], elements[root]);
+            }
+        }
+    });
+
+    ConcurrentDisjointSet merged(nr_of_elements);
+    run_on_threads(threads, [&](int t) {
+        for (auto [u, v] : spanning_forests[t]) {
+            merged.unify(u, v);
+        }
+    });
+
+    vector<int> component(nr_of_elements);
+    int elements_per_thread = (nr_of_elements + threads - 1) / threads;
+    run_on_threads(threads, [&](int t) {
+        int end = min<long>((long)(t + 1) * elements_per_thread, nr_of_elements);
+        for (int i = t * elements_per_thread; i < end; ++i) {
+            component[i] = merged.find(i);
+        }
+    });
+    return component;
+}
+
+// Answer many "same set?" queries against a flattened component array, split between the threads
+auto same_component(const vector<int> & component, const vector<pair<int, int>> & queries,
+    int threads = max(1u, thread::hardware_concurrency())) -> vector<bool> {
+
+    vector<char> answers(queries.size()); // vector<bool> packs bits so threads can't write it concurrently
+    int chunk = (queries.size() + threads - 1) / threads;
+    run_on_threads(threads, [&](int t) {
+        int end = min<long>((long)(t + 1) * chunk, queries.size());
+        for (int i = t * chunk; i < end; ++i) {
+            answers[i] = component[queries[i].first] == component[queries[i].second];
+        }
+    });
+    return vector<bool>(answers.begin(), answers.end());
+}
+
+#ifdef BENCHMARK
+#include <chrono>
+#include <random>
+
+/*
+    Compile with -DBENCHMARK to measure how ConcurrentDisjointSet scales with the number of threads
+    when computing the connected components of a random graph (n nodes and 4n random edges).
+    The edges are split evenly between the threads, and the result is checked against DisjointSet.
+*/
+auto benchmark() -> void {
+    const int n = 1 << 22;
+    mt19937 rng(0);
+    vector<pair<int, int>> edges(4 * n);
+    for (auto & [u, v] : edges) {
+        u = rng() % n;
+        v = rng() % n;
+    }
+
+    DisjointSet sequential(n);
+    auto start = chrono::steady_clock::now();
+    for (auto [u, v] : edges) {
+        sequential.unify(u, v);
+    }
+    double sequential_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "DisjointSet: " << edges.size() / sequential_time / 1e6 << " M edges/s\n";
+
+    int max_threads = max(1u, thread::hardware_concurrency());
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        ConcurrentDisjointSet ds(n);
+        start = chrono::steady_clock::now();
+        vector<thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = t; i < edges.size(); i += threads) {
+                    ds.unify(edges[i].first, edges[i].second);
+                }
+            });
+        }
+        for (thread & worker : workers) {
+            worker.join();
+        }
+        double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        bool correct = true;
+        for (int i = 0; i < n; ++i) {
+            correct &= ds.same_set(i, edges[i].first) == (sequential.find(i) == sequential.find(edges[i].first));
+        }
+        cout << "ConcurrentDisjointSet, " << threads << " threads: " << edges.size() / time / 1e6 << " M edges/s, speedup "
+            << sequential_time / time << (correct ? "" : " (WRONG RESULT)") << "\n";
+    }
+}
+#endif
+
 auto main () -> int {
+#ifdef BENCHMARK
+    benchmark();
+    return 0;
+#endif
     int nr_of_elements, nr_of_operations;
     cin >> nr_of_elements >> nr_of_operations;
 
-    DisjointSet ds(nr_of_elements);
-    strstream answers;
+    vector<char> ops(nr_of_operations);
+    vector<pair<int, int>> operands(nr_of_operations);
     for (int i = 0; i < nr_of_operations; ++i) {
-        char op;
-        int a, b;
-        cin >> op >> a >> b;
+        cin >> ops[i] >> operands[i].first >> operands[i].second;
+    }
+
+    /*
+        If all joins come before all queries we can use the offline pipeline, which first builds all
+        components and then answers every query with a single comparison.
+    */
+    auto first_query = find(ops.begin(), ops.end(), '?');
+    bool offline = find(first_query, ops.end(), '=') == ops.end();
 
-        // "= a b" indicate that the sets containing a and b are joined
-        if (op == '=') {
-            ds.unify(a, b);
+    strstream answers;
+    if (offline) {
+        vector<pair<int, int>> edges, queries;
+        for (int i = 0; i < nr_of_operations; ++i) {
+            // Like in the online loop below, operations other than '=' and '?' are ignored
+            if (ops[i] == '=') {
+                edges.push_back(operands[i]);
+            }
+            else if (ops[i] == '?') {
+                queries.push_back(operands[i]);
+            }
+        }
+        vector<int> component = connected_components(nr_of_elements, edges);
+        for (bool same : same_component(component, queries)) {
+            answers << (same ? "yes\n" : "no\n");
         }
-        // "? a b" is a query asking whether a and b belong to the same set
-        else if (op == '?') {
-            if (ds.find(a) == ds.find(b)) {
-                answers << "yes\n";
+    }
+    else {
+        DisjointSet ds(nr_of_elements);
+        for (int i = 0; i < nr_of_operations; ++i) {
+            char op = ops[i];
+            auto [a, b] = operands[i];
+
+            // "= a b" indicate that the sets containing a and b are joined
+            if (op == '=') {
+                ds.unify(a, b);
             }
-            else {
-                answers << "no\n";
+            // "? a b" is a query asking whether a and b belong to the same set
+            else if (op == '?') {
+                if (ds.find(a) == ds.find(b)) {
+                    answers << "yes\n";
+                }
+                else {
+                    answers << "no\n";
+                }
             }
         }
     }
-    cout << answers.str();
+    // strstream doesn't null terminate its buffer, so we write exactly the pcount() characters put in it
+    cout.write(answers.str(), answers.pcount());
     return 0;
 }
\ No newline at end of file